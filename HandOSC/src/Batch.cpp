@@ -0,0 +1,276 @@
+#include "Batch.h"
+#include "HandOsc.h"
+#include "Poco/Event.h"
+#include "Poco/Semaphore.h"
+#include "Poco/Environment.h"
+
+// one mask to analyze, for one frame and one set of settings
+class BatchJob {
+public:
+	int sweep, frame;
+	cv::Mat mask;
+	vector<Hand> hands;
+	Poco::Event done;
+};
+
+// a ring of jobs in frame order. the calling thread fills a job and posts
+// available, a worker claims the next job and sets its done event, and the
+// calling thread takes the results back out in the same order.
+class BatchQueue {
+public:
+	BatchQueue(int capacity)
+	:available(0, INT_MAX)
+	,next(0)
+	,total(INT_MAX) {
+		for(int i = 0; i < capacity; i++) {
+			jobs.push_back(new BatchJob());
+		}
+	}
+	~BatchQueue() {
+		for(int i = 0; i < jobs.size(); i++) {
+			delete jobs[i];
+		}
+	}
+	BatchJob& operator[](int i) {
+		return *jobs[i % jobs.size()];
+	}
+	int size() const {
+		return jobs.size();
+	}
+
+	vector<BatchJob*> jobs;
+	Poco::Semaphore available;
+	// the next job to claim, and the number of jobs once they're all queued
+	volatile int next, total;
+};
+
+// runs the frame-parallel stages: contours, resampling, curvature and peaks
+class BatchWorker : public ofThread {
+public:
+	void setup(BatchQueue& queue, const vector<HandSettings>& sweep) {
+		this->queue = &queue;
+		this->sweep = &sweep;
+		// the batch already uses every core
+		processor.setThreads(1);
+		startThread(true, false);
+	}
+
+protected:
+	void threadedFunction() {
+		while(true) {
+			queue->available.wait();
+			int i = __sync_fetch_and_add(&queue->next, 1);
+			if(i >= queue->total) {
+				break;
+			}
+			BatchJob& job = (*queue)[i];
+			processor.settings = (*sweep)[job.sweep];
+			processor.analyze(job.mask);
+			job.hands.swap(processor.getHands());
+			job.done.set();
+		}
+	}
+
+	BatchQueue* queue;
+	const vector<HandSettings>* sweep;
+	HandProcessor processor;
+};
+
+vector<HandSettings> getSweep(const HandSettings& base, const vector<string>& args) {
+	vector<HandSettings> sweep(1, base);
+	for(int i = 0; i < args.size(); i++) {
+		vector<string> parts = ofSplitString(args[i], "=");
+		if(parts.size() != 2 || getSetting(sweep[0], parts[0]) == NULL) {
+			ofLogError() << "can't sweep " << args[i];
+			continue;
+		}
+		vector<string> values = ofSplitString(parts[1], ",", true, true);
+		vector<HandSettings> expanded;
+		for(int j = 0; j < sweep.size(); j++) {
+			for(int k = 0; k < values.size(); k++) {
+				expanded.push_back(sweep[j]);
+				*getSetting(expanded.back(), parts[0]) = ofToFloat(values[k]);
+			}
+		}
+		sweep.swap(expanded);
+	}
+	return sweep;
+}
+
+// the ordered stage after the workers: follows each set of settings over
+// time and writes the results
+class BatchOutput {
+public:
+	BatchOutput(string output, const vector<HandSettings>& sweep, float frameRate)
+	:sweep(sweep)
+	,frameRate(frameRate)
+	,start(getMonotonicMicros()) {
+		for(int i = 0; i < sweep.size(); i++) {
+			trackers.push_back(new HandProcessor());
+			trackers.back()->settings = sweep[i];
+		}
+		if(ofFilePath::getFileExt(output) == "osc") {
+			for(int i = 0; i < sweep.size(); i++) {
+				logs.push_back(new HandOsc());
+				string logPath = sweep.size() == 1 ? output : ofFilePath::removeExt(output) + "-" + ofToString(i) + ".osc";
+				logs.back()->setupLog(logPath);
+			}
+		} else {
+			csv.open(ofToDataPath(output).c_str());
+			csv << "sweep,frame,time,hand,area,x,y,finger,fingerX,fingerY" << endl;
+		}
+		if(sweep.size() > 1) {
+			writeSweep(ofFilePath::removeExt(output) + "-sweep.csv");
+		}
+	}
+	~BatchOutput() {
+		for(int i = 0; i < trackers.size(); i++) {
+			delete trackers[i];
+		}
+		for(int i = 0; i < logs.size(); i++) {
+			delete logs[i];
+		}
+	}
+
+	// waits for the job to be analyzed first
+	void write(BatchJob& job) {
+		job.done.wait();
+		float time = job.frame / frameRate;
+		unsigned long long captured = start + time * 1e6;
+		trackers[job.sweep]->track(job.hands, captured);
+		if(logs.empty()) {
+			writeHands(job.sweep, job.frame, time, job.hands);
+		} else {
+			logs[job.sweep]->send(job.hands, sweep[job.sweep].multiHand, captured, job.frame);
+		}
+	}
+
+protected:
+	void writeSweep(string path) {
+		ofstream file(ofToDataPath(path).c_str());
+		const vector<string>& names = getSettingNames();
+		file << "sweep";
+		for(int i = 0; i < names.size(); i++) {
+			file << "," << names[i];
+		}
+		file << endl;
+		for(int i = 0; i < sweep.size(); i++) {
+			HandSettings settings = sweep[i];
+			file << i;
+			for(int j = 0; j < names.size(); j++) {
+				file << "," << *getSetting(settings, names[j]);
+			}
+			file << endl;
+		}
+	}
+	// one row per finger, one without a finger for a hand with none, and
+	// one without a hand for a frame with none, so every frame is there
+	void writeHands(int sweep, int frame, float time, const vector<Hand>& hands) {
+		if(hands.empty()) {
+			csv << sweep << "," << frame << "," << time << ",,,,,,," << endl;
+		}
+		for(int i = 0; i < hands.size(); i++) {
+			const Hand& hand = hands[i];
+			string prefix = ofToString(sweep) + "," + ofToString(frame) + "," + ofToString(time) + "," +
+				ofToString(hand.id) + "," + ofToString(hand.area) + "," +
+				ofToString(hand.centroid.x) + "," + ofToString(hand.centroid.y) + ",";
+			if(hand.trackedFingers.empty()) {
+				csv << prefix << ",," << endl;
+			}
+			for(int j = 0; j < hand.trackedFingers.size(); j++) {
+				const TrackedFinger& finger = hand.trackedFingers[j];
+				csv << prefix << finger.id << "," << finger.predicted.x << "," << finger.predicted.y << endl;
+			}
+		}
+	}
+
+	const vector<HandSettings>& sweep;
+	float frameRate;
+	unsigned long long start;
+	vector<HandProcessor*> trackers;
+	ofstream csv;
+	vector<HandOsc*> logs;
+};
+
+int runBatch(string path, string output, const vector<HandSettings>& settings, int threads) {
+	FrameSource* source = openFrameSource(path);
+	if(source == NULL) {
+		return 1;
+	}
+	if(threads < 1) {
+		threads = Poco::Environment::processorCount();
+	}
+	
+	// the roi depends on the hands found in the previous frame, so it can't
+	// be used when frames are analyzed out of order
+	vector<HandSettings> sweep = settings;
+	for(int i = 0; i < sweep.size(); i++) {
+		sweep[i].tracking = false;
+	}
+
+	// decoding and background subtraction happen here in frame order, once
+	// per set of settings
+	int sweeps = sweep.size();
+	vector<HandProcessor*> backgrounds;
+	for(int i = 0; i < sweeps; i++) {
+		backgrounds.push_back(new HandProcessor());
+		backgrounds.back()->settings = sweep[i];
+	}
+	BatchOutput results(output, sweep, source->getFrameRate());
+
+	// the calling thread is mostly busy with the sequential stages
+	int workerCount = MAX(threads - 1, 1);
+	BatchQueue queue(MAX(4 * workerCount, 2 * sweeps));
+	vector<BatchWorker*> workers;
+	for(int i = 0; i < workerCount; i++) {
+		workers.push_back(new BatchWorker());
+		workers.back()->setup(queue, sweep);
+	}
+
+	unsigned long long start = getMonotonicMicros();
+	int produced = 0, written = 0, frames = 0;
+	cv::Mat frame;
+	while(source->read(frame)) {
+		for(int i = 0; i < sweeps; i++) {
+			// when the ring is full the oldest job has to come out first
+			if(produced - written == queue.size()) {
+				results.write(queue[written++]);
+			}
+			BatchJob& job = queue[produced++];
+			job.sweep = i;
+			job.frame = frames;
+			backgrounds[i]->subtractBackground(frame);
+			backgrounds[i]->getThresholded().copyTo(job.mask);
+			queue.available.set();
+		}
+		frames++;
+	}
+
+	// wake every worker once more so they see there's nothing left
+	queue.total = produced;
+	__sync_synchronize();
+	for(int i = 0; i < workers.size(); i++) {
+		queue.available.set();
+	}
+	while(written < produced) {
+		results.write(queue[written++]);
+	}
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->waitForThread(false);
+		delete workers[i];
+	}
+	for(int i = 0; i < sweeps; i++) {
+		delete backgrounds[i];
+	}
+	float seconds = (getMonotonicMicros() - start) / 1e6;
+	float frameRate = source->getFrameRate();
+	delete source;
+
+	if(frames == 0) {
+		ofLogError() << "no frames in " << path;
+		return 1;
+	}
+	cout << path << ": " << frames << " frames with " << sweeps << " settings on " << threads << " threads" << endl;
+	cout << (frames / seconds) << " fps, " << (frames / seconds / frameRate) << "x real time" << endl;
+	return 0;
+}
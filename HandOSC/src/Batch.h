@@ -0,0 +1,15 @@
+#pragma once
+
+#include "HandProcessor.h"
+#include "FrameSource.h"
+
+// runs a video or recording through the pipeline on every core, faster
+// than real time, and writes every frame's hands to output: a csv file, or
+// OSC logs if output ends in .osc. each entry of sweep is a complete set of
+// settings, and all of them are run over the same decoded frames.
+// returns a process exit code so main() can hand it straight back.
+int runBatch(string path, string output, const vector<HandSettings>& sweep, int threads = 0);
+
+// expands arguments like "threshold=32,48,64" into every combination of
+// their values, starting from base
+vector<HandSettings> getSweep(const HandSettings& base, const vector<string>& args);
@@ -0,0 +1,143 @@
+#include "Benchmark.h"
+
+unsigned long long getPercentile(vector<unsigned long long>& samples, float percentile) {
+	if(samples.empty()) {
+		return 0;
+	}
+	sort(samples.begin(), samples.end());
+	int i = ofClamp(percentile * samples.size(), 0, samples.size() - 1);
+	return samples[i];
+}
+
+int runBenchmark(string path, HandSettings settings) {
+	FrameSource* source = openFrameSource(path);
+	if(source == NULL) {
+		return 1;
+	}
+	
+	HandProcessor processor;
+	processor.settings = settings;
+	vector<unsigned long long> stageSamples[STAGE_COUNT], totalSamples;
+	int frames = 0, hands = 0;
+	double pixelFraction = 0;
+	cv::Mat frame;
+	unsigned long long start = getMonotonicMicros();
+	while(source->read(frame)) {
+		unsigned long long frameStart = getMonotonicMicros();
+		if(processor.update(frame)) {
+			hands++;
+		}
+		totalSamples.push_back(getMonotonicMicros() - frameStart);
+		for(int i = 0; i < STAGE_COUNT; i++) {
+			stageSamples[i].push_back(processor.getStageMicros(i));
+		}
+		if(settings.tracking) {
+			pixelFraction += processor.getTrackedBackground().getPixelFraction();
+		}
+		frames++;
+	}
+	// includes decoding, the per-stage numbers don't
+	float seconds = (getMonotonicMicros() - start) / 1e6;
+	delete source;
+	
+	if(frames == 0) {
+		ofLogError() << "no frames in " << path;
+		return 1;
+	}
+	
+	cout << path << ": " << frames << " frames, hand found in " << hands << endl;
+	cout << "stage\tp50\tp90\tp99\tmax (us)" << endl;
+	for(int i = 0; i <= STAGE_COUNT; i++) {
+		vector<unsigned long long>& samples = i < STAGE_COUNT ? stageSamples[i] : totalSamples;
+		// sorted here since the order the stream arguments are evaluated in
+		// isn't specified
+		sort(samples.begin(), samples.end());
+		cout << (i < STAGE_COUNT ? getStageName(i) : "total") << "\t"
+			<< getPercentile(samples, .50) << "\t"
+			<< getPercentile(samples, .90) << "\t"
+			<< getPercentile(samples, .99) << "\t"
+			<< samples.back() << endl;
+	}
+	if(settings.tracking) {
+		cout << "full resolution pixels processed: " << (100 * pixelFraction / frames) << "%" << endl;
+	}
+	cout << (frames / seconds) << " fps" << endl;
+	return 0;
+}
+
+// fingertips within this many pixels of each other are the same finger
+static const float matchDistance = 20;
+
+int runComparison(string path, HandSettings settings) {
+	FrameSource* source = openFrameSource(path);
+	if(source == NULL) {
+		return 1;
+	}
+	
+	HandProcessor processor;
+	processor.settings = settings;
+	processor.settings.hullFingers = false;
+	HandSettings hullSettings = processor.settings;
+	hullSettings.hullFingers = true;
+	HandAnalyzer hullAnalyzer;
+	
+	vector<unsigned long long> curvatureSamples, hullSamples;
+	int frames = 0, curvatureFingers = 0, hullFingers = 0, matched = 0;
+	float matchedDistance = 0;
+	cv::Mat frame;
+	while(source->read(frame)) {
+		frames++;
+		if(!processor.update(frame)) {
+			continue;
+		}
+		unsigned long long curvatureMicros = 0;
+		for(int i = STAGE_RESAMPLE; i <= STAGE_FINGERS; i++) {
+			curvatureMicros += processor.getStageMicros(i);
+		}
+		curvatureSamples.push_back(curvatureMicros);
+		
+		Hand& reference = processor.getHands()[0];
+		Hand hand = reference;
+		unsigned long long start = getMonotonicMicros();
+		hullAnalyzer.analyze(hand, hullSettings, frame.rows);
+		hullSamples.push_back(getMonotonicMicros() - start);
+		
+		// greedily pair each curvature fingertip with the nearest hull one
+		vector<bool> used(hand.fingers.size(), false);
+		for(int i = 0; i < reference.fingers.size(); i++) {
+			int best = -1;
+			float bestDistance = matchDistance;
+			for(int j = 0; j < hand.fingers.size(); j++) {
+				float distance = reference.fingers[i].distance(hand.fingers[j]);
+				if(!used[j] && distance < bestDistance) {
+					best = j;
+					bestDistance = distance;
+				}
+			}
+			if(best >= 0) {
+				used[best] = true;
+				matched++;
+				matchedDistance += bestDistance;
+			}
+		}
+		curvatureFingers += reference.fingers.size();
+		hullFingers += hand.fingers.size();
+	}
+	delete source;
+	
+	if(curvatureSamples.empty()) {
+		ofLogError() << "no hands in " << path;
+		return 1;
+	}
+	
+	cout << path << ": " << frames << " frames, hand found in " << curvatureSamples.size() << endl;
+	cout << "detector\tp50\tp99 (us)\tfingertips" << endl;
+	cout << "curvature\t" << getPercentile(curvatureSamples, .50) << "\t" << getPercentile(curvatureSamples, .99) << "\t" << curvatureFingers << endl;
+	cout << "hull\t\t" << getPercentile(hullSamples, .50) << "\t" << getPercentile(hullSamples, .99) << "\t" << hullFingers << endl;
+	cout << "hull found " << matched << " of " << curvatureFingers << " curvature fingertips";
+	if(matched > 0) {
+		cout << ", " << (matchedDistance / matched) << " px away on average";
+	}
+	cout << ", plus " << (hullFingers - matched) << " others" << endl;
+	return 0;
+}
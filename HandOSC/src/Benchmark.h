@@ -0,0 +1,17 @@
+#pragma once
+
+#include "HandProcessor.h"
+#include "FrameSource.h"
+
+// runs a recording through HandProcessor as fast as possible and prints
+// per-stage latency percentiles and overall frames per second.
+// returns a process exit code so main() can hand it straight back.
+int runBenchmark(string path, HandSettings settings = HandSettings());
+
+// runs the curvature fingertip detector and HullDetector on the same
+// contours and prints the cost of each and how well their fingertips agree,
+// taking the curvature fingertips as the reference
+int runComparison(string path, HandSettings settings = HandSettings());
+
+// nearest-rank percentile, sorts samples in place
+unsigned long long getPercentile(vector<unsigned long long>& samples, float percentile);
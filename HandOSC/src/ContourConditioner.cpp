@@ -0,0 +1,109 @@
+#include "ContourConditioner.h"
+
+void ContourConditioner::update(const ofPolyline& contour, float spacing, int smoothing, ofPolyline& resampled) {
+	const vector<ofPoint>& points = contour.getVertices();
+	vector<ofPoint>& vertices = resampled.getVertices();
+	if(points.empty() || spacing <= 0) {
+		vertices = points;
+		resampled.setClosed(contour.isClosed());
+		resampled.flagHasChanged();
+		return;
+	}
+	
+	// the same perimeter and point count as getResampledBySpacing()
+	int n = points.size();
+	float perimeter = 0;
+	for(int i = 0; i < n; i++) {
+		perimeter += points[i].distance(points[(i + 1) % n]);
+	}
+	int m = 0;
+	for(float f = 0; f < perimeter; f += spacing) {
+		m++;
+	}
+	
+	smoothing = ofClamp(smoothing, 0, m);
+	int pad = MAX(smoothing - 1, 0);
+	resample(points, spacing, perimeter, pad);
+	smooth(m, smoothing, vertices);
+	resampled.setClosed(true);
+	resampled.flagHasChanged();
+}
+
+void ContourConditioner::resample(const vector<ofPoint>& points, float spacing, float perimeter, int pad) {
+	int n = points.size();
+	int m = 0;
+	x.resize(pad);
+	y.resize(pad);
+	
+	int segment = 0;
+	float segmentStart = 0;
+	float segmentEnd = points[0].distance(points[1 % n]);
+	for(float f = 0; f < perimeter; f += spacing) {
+		while(segmentEnd < f && segment < n - 1) {
+			segment++;
+			segmentStart = segmentEnd;
+			segmentEnd += points[segment].distance(points[(segment + 1) % n]);
+		}
+		const ofPoint& a = points[segment];
+		const ofPoint& b = points[(segment + 1) % n];
+		float t = segmentEnd > segmentStart ? (f - segmentStart) / (segmentEnd - segmentStart) : 0;
+		x.push_back(a.x * (1 - t) + b.x * t);
+		y.push_back(a.y * (1 - t) + b.y * t);
+		m++;
+	}
+	
+	// wrap the ends around so the smoothing window never needs a modulo
+	x.resize(m + 2 * pad);
+	y.resize(m + 2 * pad);
+	for(int i = 0; i < pad; i++) {
+		x[i] = x[m + i];
+		y[i] = y[m + i];
+		x[pad + m + i] = x[pad + i];
+		y[pad + m + i] = y[pad + i];
+	}
+}
+
+void ContourConditioner::smooth(int n, int smoothing, vector<ofPoint>& smoothed) {
+	smoothed.resize(n);
+	int pad = MAX(smoothing - 1, 0);
+	if(smoothing < 2) {
+		for(int i = 0; i < n; i++) {
+			smoothed[i].set(x[pad + i], y[pad + i], 0);
+		}
+		return;
+	}
+	
+	// getSmoothed() weighs the neighbor at distance j by 1 - j / k, which
+	// sums to k, and is the same as a box of width k applied twice over k^2
+	int k = smoothing;
+	int boxes = n + k - 1;
+	boxX.resize(boxes);
+	boxY.resize(boxes);
+	double sumX = 0, sumY = 0;
+	for(int i = 0; i < k - 1; i++) {
+		sumX += x[i];
+		sumY += y[i];
+	}
+	for(int i = 0; i < boxes; i++) {
+		sumX += x[i + k - 1];
+		sumY += y[i + k - 1];
+		boxX[i] = sumX;
+		boxY[i] = sumY;
+		sumX -= x[i];
+		sumY -= y[i];
+	}
+	
+	double normalize = 1. / (k * k);
+	sumX = 0, sumY = 0;
+	for(int i = 0; i < k - 1; i++) {
+		sumX += boxX[i];
+		sumY += boxY[i];
+	}
+	for(int i = 0; i < n; i++) {
+		sumX += boxX[i + k - 1];
+		sumY += boxY[i + k - 1];
+		smoothed[i].set(sumX * normalize, sumY * normalize, 0);
+		sumX -= boxX[i];
+		sumY -= boxY[i];
+	}
+}
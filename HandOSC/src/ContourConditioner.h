@@ -0,0 +1,23 @@
+#pragma once
+
+#include "ofMain.h"
+
+// replaces contour.getResampledBySpacing(spacing).getSmoothed(smoothing).
+// the resampled points are generated by walking the contour once, and the
+// triangular smoothing kernel of getSmoothed is applied as two running box
+// sums, so the cost doesn't depend on the smoothing size. everything is
+// written into buffers that are reused from frame to frame, including the
+// vertices of the output polyline, so nothing allocates in steady state.
+class ContourConditioner {
+public:
+	void update(const ofPolyline& contour, float spacing, int smoothing, ofPolyline& resampled);
+	
+protected:
+	void resample(const vector<ofPoint>& points, float spacing, float perimeter, int pad);
+	void smooth(int n, int smoothing, vector<ofPoint>& smoothed);
+	
+	// resampled points with pad points of wrap-around on either side
+	vector<float> x, y;
+	// running box sums of x and y
+	vector<float> boxX, boxY;
+};
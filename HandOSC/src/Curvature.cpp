@@ -0,0 +1,107 @@
+#include "Curvature.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// minimax polynomial for atan on [0, 1], max error around 1e-5 radians
+static const float atanCoefficients[] = {
+	+0.99997726f, -0.33262347f, +0.19354346f, -0.11643287f, +0.05265332f, -0.01172120f
+};
+
+// signed angle in degrees from (ax, ay) to (cx, cy), mapped the same way as
+// buildContourAnalysis: straight lines are 0, sharp convex turns approach 180
+inline float getCurvature(float ax, float ay, float cx, float cy) {
+	float angle = atan2f(ax * cy - ay * cx, ax * cx + ay * cy) * RAD_TO_DEG;
+	return angle > 0 ? 180 - angle : -180 - angle;
+}
+
+void Curvature::update(const ofPolyline& polyline, int offset, vector<float>& curvature) {
+	int n = polyline.size();
+	offset = MIN(offset, n);
+	curvature.resize(n);
+	if(n == 0) {
+		return;
+	}
+	paddedX.resize(n + 2 * offset);
+	paddedY.resize(n + 2 * offset);
+	for(int i = 0; i < n + 2 * offset; i++) {
+		const ofPoint& cur = polyline[(i - offset + 2 * n) % n];
+		paddedX[i] = cur.x;
+		paddedY[i] = cur.y;
+	}
+	analyze(n, offset, &curvature[0]);
+}
+
+void Curvature::update(const float* x, const float* y, int n, int offset, float* curvature) {
+	offset = MIN(offset, n);
+	if(n == 0) {
+		return;
+	}
+	paddedX.resize(n + 2 * offset);
+	paddedY.resize(n + 2 * offset);
+	copy(x + n - offset, x + n, paddedX.begin());
+	copy(y + n - offset, y + n, paddedY.begin());
+	copy(x, x + n, paddedX.begin() + offset);
+	copy(y, y + n, paddedY.begin() + offset);
+	copy(x, x + offset, paddedX.begin() + offset + n);
+	copy(y, y + offset, paddedY.begin() + offset + n);
+	analyze(n, offset, curvature);
+}
+
+void Curvature::analyze(int n, int offset, float* curvature) {
+	const float* left[2] = {&paddedX[0], &paddedY[0]};
+	const float* center[2] = {left[0] + offset, left[1] + offset};
+	const float* right[2] = {left[0] + 2 * offset, left[1] + 2 * offset};
+	int i = 0;
+	
+#ifdef __SSE2__
+	const __m128 signMask = _mm_set1_ps(-0.f);
+	const __m128 tiny = _mm_set1_ps(FLT_MIN);
+	const __m128 halfPi = _mm_set1_ps(HALF_PI);
+	const __m128 pi = _mm_set1_ps(PI);
+	const __m128 radToDeg = _mm_set1_ps(RAD_TO_DEG);
+	const __m128 straight = _mm_set1_ps(180);
+	const __m128 zero = _mm_setzero_ps();
+	for(; i + 4 <= n; i += 4) {
+		__m128 bx = _mm_loadu_ps(center[0] + i), by = _mm_loadu_ps(center[1] + i);
+		__m128 ax = _mm_sub_ps(_mm_loadu_ps(left[0] + i), bx);
+		__m128 ay = _mm_sub_ps(_mm_loadu_ps(left[1] + i), by);
+		__m128 cx = _mm_sub_ps(_mm_loadu_ps(right[0] + i), bx);
+		__m128 cy = _mm_sub_ps(_mm_loadu_ps(right[1] + i), by);
+		__m128 cross = _mm_sub_ps(_mm_mul_ps(ax, cy), _mm_mul_ps(ay, cx));
+		__m128 dot = _mm_add_ps(_mm_mul_ps(ax, cx), _mm_mul_ps(ay, cy));
+		
+		// atan2(cross, dot) reduced to atan on [0, 1]
+		__m128 absCross = _mm_andnot_ps(signMask, cross);
+		__m128 absDot = _mm_andnot_ps(signMask, dot);
+		__m128 hi = _mm_max_ps(_mm_max_ps(absCross, absDot), tiny);
+		__m128 lo = _mm_min_ps(absCross, absDot);
+		__m128 t = _mm_div_ps(lo, hi);
+		__m128 s = _mm_mul_ps(t, t);
+		__m128 r = _mm_set1_ps(atanCoefficients[5]);
+		for(int k = 4; k >= 0; k--) {
+			r = _mm_add_ps(_mm_mul_ps(r, s), _mm_set1_ps(atanCoefficients[k]));
+		}
+		r = _mm_mul_ps(r, t);
+		__m128 steep = _mm_cmpgt_ps(absCross, absDot);
+		r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(halfPi, r)), _mm_andnot_ps(steep, r));
+		// test the sign bit rather than dot < 0 so -0 wraps to 180 like atan2f
+		__m128 behind = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(dot), 31));
+		r = _mm_or_ps(_mm_and_ps(behind, _mm_sub_ps(pi, r)), _mm_andnot_ps(behind, r));
+		
+		// the sign of the angle is the sign of the cross product. the mapping
+		// (angle > 0 ? 180 - angle : -180 - angle) is sign(angle) * (180 - |angle|)
+		// which keeps |angle| = r and copies the sign of cross onto it.
+		__m128 result = _mm_sub_ps(straight, _mm_mul_ps(r, radToDeg));
+		__m128 positive = _mm_cmpgt_ps(cross, zero);
+		result = _mm_or_ps(_mm_and_ps(positive, result), _mm_andnot_ps(positive, _mm_xor_ps(result, signMask)));
+		_mm_storeu_ps(curvature + i, result);
+	}
+#endif
+	
+	for(; i < n; i++) {
+		float bx = center[0][i], by = center[1][i];
+		curvature[i] = getCurvature(left[0][i] - bx, left[1][i] - by, right[0][i] - bx, right[1][i] - by);
+	}
+}
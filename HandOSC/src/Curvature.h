@@ -0,0 +1,21 @@
+#pragma once
+
+#include "ofMain.h"
+
+// vectorized replacement for buildContourAnalysis. the contour is unrolled
+// into padded x/y arrays so the circular neighbors at +/- offset are plain
+// contiguous loads, and the angle comes from a polynomial atan2 instead of
+// ofVec2f::angle. uses SSE2 when available and falls back to scalar code.
+// agrees with buildContourAnalysis to within ~0.001 degrees.
+class Curvature {
+public:
+	void update(const ofPolyline& polyline, int offset, vector<float>& curvature);
+	// x and y hold n points of a closed contour, curvature needs room for n
+	void update(const float* x, const float* y, int n, int offset, float* curvature);
+
+protected:
+	void analyze(int n, int offset, float* curvature);
+
+	// n + 2 * offset points, with the last and first offset points wrapped around
+	vector<float> paddedX, paddedY;
+};
@@ -0,0 +1,147 @@
+#include "Daemon.h"
+#include <signal.h>
+
+static volatile sig_atomic_t stopping = 0;
+
+static void stop(int signal) {
+	stopping = 1;
+}
+
+// without SA_RESTART, so a read blocked on a stalled source returns EINTR
+// and the source can see it's stopping
+static void handleSignal(int signal) {
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stop;
+	sigemptyset(&action.sa_mask);
+	sigaction(signal, &action, NULL);
+}
+
+void loadSettings(ofxXmlSettings& xml, HandSettings& settings) {
+	const vector<string>& names = getSettingNames();
+	for(int i = 0; i < names.size(); i++) {
+		float* setting = getSetting(settings, names[i]);
+		*setting = xml.getValue(names[i], (double) *setting);
+	}
+	const vector<string>& toggles = getToggleNames();
+	for(int i = 0; i < toggles.size(); i++) {
+		bool* toggle = getToggle(settings, toggles[i]);
+		*toggle = xml.getValue(toggles[i], (int) *toggle) != 0;
+	}
+}
+
+void saveSettings(ofxXmlSettings& xml, HandSettings& settings) {
+	const vector<string>& names = getSettingNames();
+	for(int i = 0; i < names.size(); i++) {
+		xml.setValue(names[i], (double) *getSetting(settings, names[i]));
+	}
+	const vector<string>& toggles = getToggleNames();
+	for(int i = 0; i < toggles.size(); i++) {
+		xml.setValue(toggles[i], (int) *getToggle(settings, toggles[i]));
+	}
+}
+
+// applies every control message that arrived since the last frame, between
+// frames so the processor never sees settings change halfway through one
+static void receiveControl(ofxOscReceiver& control, HandProcessor& processor, ofxXmlSettings& xml) {
+	ofxOscMessage message;
+	while(control.hasWaitingMessages()) {
+		control.getNextMessage(&message);
+		string address = message.getAddress();
+		if(address == "/reset") {
+			processor.reset();
+		} else if(address == "/save") {
+			if(!xml.tagExists("settings")) {
+				xml.addTag("settings");
+			}
+			xml.pushTag("settings");
+			saveSettings(xml, processor.settings);
+			xml.popTag();
+			xml.saveFile("settings.xml");
+		} else if(address.find("/settings/") == 0 && message.getNumArgs() > 0) {
+			string name = address.substr(string("/settings/").size());
+			float value = message.getArgType(0) == OFXOSC_TYPE_INT32 ?
+				message.getArgAsInt32(0) : message.getArgAsFloat(0);
+			float* setting = getSetting(processor.settings, name);
+			bool* toggle = getToggle(processor.settings, name);
+			if(setting != NULL) {
+				*setting = value;
+			} else if(toggle != NULL) {
+				*toggle = value != 0;
+			} else {
+				ofLogWarning() << "no setting called " << name;
+			}
+		} else {
+			ofLogWarning() << "unknown control message " << address;
+		}
+	}
+}
+
+int runDaemon(string path) {
+	ofxXmlSettings xml;
+	xml.loadFile("settings.xml");
+	if(path.empty()) {
+		path = xml.getValue("source", "/dev/video0");
+	}
+	int width = xml.getValue("width", 640);
+	int height = xml.getValue("height", 480);
+	FrameSource* source = openFrameSource(path, width, height);
+	if(source == NULL) {
+		return 1;
+	}
+	
+	HandProcessor processor;
+	if(xml.tagExists("settings")) {
+		xml.pushTag("settings");
+		loadSettings(xml, processor.settings);
+		xml.popTag();
+	}
+	
+	string host = xml.getValue("host", "localhost");
+	int port = xml.getValue("port", 8000);
+	HandOsc osc;
+	osc.setup(host, port, xml.getValue("bundled", 0));
+	if(xml.getValue("shared", 0)) {
+		osc.setupShared(xml.getValue("sharedName", SHARED_HANDS_NAME));
+	}
+	HandStats stats;
+	stats.setup(xml.getValue("statsInterval", 1.0), xml.getValue("statsLog", ""));
+	int controlPort = xml.getValue("controlPort", 9000);
+	ofxOscReceiver control;
+	control.setup(controlPort);
+	
+	source->setStopping(&stopping);
+	handleSignal(SIGINT);
+	handleSignal(SIGTERM);
+	ofLogNotice() << "reading " << path << ", sending to " << host << ":" << port << ", control on port " << controlPort;
+	
+	// recordings and files are played back at their frame rate, like a camera
+	float frameRate = source->getFrameRate();
+	unsigned long long start = getMonotonicMicros();
+	unsigned int sequence = 0;
+	cv::Mat frame;
+	while(!stopping && source->read(frame)) {
+		FrameTimes times;
+		if(source->isLive()) {
+			times.captured = source->getCaptured();
+		} else {
+			times.captured = start + sequence * 1e6 / frameRate;
+			while(getMonotonicMicros() < times.captured) {
+				ofSleepMillis(1);
+			}
+		}
+		receiveControl(control, processor, xml);
+		times.started = getMonotonicMicros();
+		processor.update(frame, times.captured);
+		times.processed = getMonotonicMicros();
+		osc.send(processor.getHands(), processor.settings.multiHand, times.captured, sequence++);
+		times.sent = getMonotonicMicros();
+		stats.add(processor, times);
+		if(stats.update(source->getDroppedFrames())) {
+			osc.sendStats(stats.getSummary());
+		}
+	}
+	delete source;
+	ofLogNotice() << "stopped after " << sequence << " frames";
+	return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "HandProcessor.h"
+#include "HandOsc.h"
+#include "HandStats.h"
+#include "FrameSource.h"
+#include "ofxXmlSettings.h"
+
+// HandOSC without a window, GL context or gui. frames come from a
+// FrameSource, hands go out over OSC like the app, and the settings start
+// from the <settings> block of settings.xml and can be changed over OSC:
+//
+//	/settings/<name> <value>	a slider or toggle, named like HandSettings
+//	/reset	relearn the background
+//	/save	write the current settings to settings.xml
+//
+// source overrides the <source> in settings.xml. runs until the source
+// runs out or the process is interrupted, and returns a process exit code
+// so main() can hand it straight back.
+int runDaemon(string source = "");
+
+// reads and writes the sliders and toggles in the current tag
+void loadSettings(ofxXmlSettings& xml, HandSettings& settings);
+void saveSettings(ofxXmlSettings& xml, HandSettings& settings);
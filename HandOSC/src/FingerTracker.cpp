@@ -0,0 +1,114 @@
+#include "FingerTracker.h"
+
+void KalmanAxis::setup(float position) {
+	this->position = position;
+	velocity = 0;
+	p00 = 1, p01 = 0, p11 = 1e5;
+}
+
+void KalmanAxis::predict(float dt, float processNoise) {
+	position += velocity * dt;
+	// P = F P F' + Q with white acceleration noise
+	float dt2 = dt * dt;
+	p00 += 2 * dt * p01 + dt2 * p11 + processNoise * dt2 * dt2 / 4;
+	p01 += dt * p11 + processNoise * dt2 * dt / 2;
+	p11 += processNoise * dt2;
+}
+
+void KalmanAxis::correct(float measurement, float measurementNoise) {
+	float residual = measurement - position;
+	float s = p00 + measurementNoise;
+	float k0 = p00 / s, k1 = p01 / s;
+	position += k0 * residual;
+	velocity += k1 * residual;
+	p11 -= k1 * p01;
+	p01 -= k1 * p00;
+	p00 -= k0 * p00;
+}
+
+FingerTracker::FingerTracker()
+:maxDistance(40)
+,persistence(3)
+,processNoise(1e6)
+,measurementNoise(4)
+,lastCaptured(0) {
+}
+
+void FingerTracker::update(const vector<ofVec2f>& fingers, unsigned long long captured, float lookahead, vector<TrackedFinger>& tracked) {
+	float dt = tracks.empty() || captured < lastCaptured ? 0 : (captured - lastCaptured) / 1e6;
+	lastCaptured = captured;
+	for(int i = 0; i < tracks.size(); i++) {
+		tracks[i].x.predict(dt, processNoise);
+		tracks[i].y.predict(dt, processNoise);
+	}
+	
+	// greedily match the closest finger and track pairs first
+	distances.clear();
+	for(int i = 0; i < tracks.size(); i++) {
+		ofVec2f predicted(tracks[i].x.position, tracks[i].y.position);
+		for(int j = 0; j < fingers.size(); j++) {
+			float distance = predicted.distance(fingers[j]);
+			if(distance < maxDistance) {
+				distances.push_back(make_pair(distance, make_pair(i, j)));
+			}
+		}
+	}
+	ofSort(distances);
+	trackMatched.assign(tracks.size(), false);
+	fingerMatched.assign(fingers.size(), false);
+	tracked.clear();
+	for(int k = 0; k < distances.size(); k++) {
+		int i = distances[k].second.first, j = distances[k].second.second;
+		if(trackMatched[i] || fingerMatched[j]) {
+			continue;
+		}
+		trackMatched[i] = fingerMatched[j] = true;
+		Track& track = tracks[i];
+		track.x.correct(fingers[j].x, measurementNoise);
+		track.y.correct(fingers[j].y, measurementNoise);
+		track.missed = 0;
+	}
+	
+	for(int i = tracks.size() - 1; i >= 0; i--) {
+		if(!trackMatched[i] && ++tracks[i].missed > persistence) {
+			tracks.erase(tracks.begin() + i);
+			trackMatched.erase(trackMatched.begin() + i);
+		}
+	}
+	for(int j = 0; j < fingers.size(); j++) {
+		if(!fingerMatched[j]) {
+			Track track;
+			track.id = getFreeId();
+			track.x.setup(fingers[j].x);
+			track.y.setup(fingers[j].y);
+			track.missed = 0;
+			tracks.push_back(track);
+			trackMatched.push_back(true);
+		}
+	}
+	
+	// only report fingers that were seen this frame
+	for(int i = 0; i < tracks.size(); i++) {
+		if(!trackMatched[i]) {
+			continue;
+		}
+		Track& track = tracks[i];
+		TrackedFinger finger;
+		finger.id = track.id;
+		finger.position.set(track.x.position, track.y.position);
+		finger.velocity.set(track.x.velocity, track.y.velocity);
+		finger.predicted = finger.position + finger.velocity * lookahead;
+		tracked.push_back(finger);
+	}
+}
+
+unsigned int FingerTracker::getFreeId() const {
+	unsigned int id = 0;
+	for(int i = 0; i < tracks.size(); i++) {
+		if(tracks[i].id == id) {
+			id++;
+			i = -1;
+		}
+	}
+	return id;
+}
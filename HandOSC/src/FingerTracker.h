@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Hand.h"
+
+// constant velocity kalman filter for one axis
+class KalmanAxis {
+public:
+	void setup(float position);
+	void predict(float dt, float processNoise);
+	void correct(float measurement, float measurementNoise);
+	
+	float position, velocity;
+	
+protected:
+	// covariance of position and velocity
+	float p00, p01, p11;
+};
+
+// follows the fingertips of one hand from frame to frame. each detected
+// fingertip is matched to the nearest existing finger, filtered with a
+// constant velocity model and extrapolated forward to hide latency. ids are
+// the smallest ones not already in use, so they stay small and only change
+// when a finger is lost.
+class FingerTracker {
+public:
+	FingerTracker();
+	
+	// captured is when the frame was captured, in microseconds. lookahead is
+	// how far past that time the predicted positions should be, in seconds.
+	void update(const vector<ofVec2f>& fingers, unsigned long long captured, float lookahead, vector<TrackedFinger>& tracked);
+	
+	// fingertips further than this from their prediction start a new finger
+	float maxDistance;
+	// frames a finger can go undetected before it's dropped
+	int persistence;
+	float processNoise, measurementNoise;
+	
+protected:
+	class Track {
+	public:
+		unsigned int id;
+		KalmanAxis x, y;
+		int missed;
+	};
+	
+	unsigned int getFreeId() const;
+	
+	vector<Track> tracks;
+	vector< pair<float, pair<int, int> > > distances;
+	vector<bool> trackMatched, fingerMatched;
+	// kept in microseconds, a float in seconds loses the frame interval
+	// after a few days of uptime
+	unsigned long long lastCaptured;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ofMain.h"
+
+// bounded single producer, single consumer ring of preallocated slots.
+// the producer fills the slot from beginWrite() and publishes it with
+// endWrite(), the consumer does the same with beginRead() and endRead().
+// neither side ever blocks or locks: beginWrite() returns NULL when the
+// ring is full and beginRead() returns NULL when it's empty. a consumer that
+// only wants the newest slot can skip the older ones with skipToNewest().
+template <class T>
+class FrameRing {
+public:
+	FrameRing()
+	:mask(0)
+	,readIndex(0)
+	,writeIndex(0) {
+	}
+	// rounds size up to a power of two so the indices can wrap freely
+	void setup(int size) {
+		int capacity = 1;
+		while(capacity < size) {
+			capacity <<= 1;
+		}
+		slots.resize(capacity);
+		mask = capacity - 1;
+		readIndex = 0;
+		writeIndex = 0;
+	}
+	int size() const {
+		return slots.size();
+	}
+	T& operator[](int i) {
+		return slots[i];
+	}
+	T* beginWrite() {
+		if(writeIndex - readIndex == slots.size()) {
+			return NULL;
+		}
+		return &slots[writeIndex & mask];
+	}
+	void endWrite() {
+		// the slot contents must be visible before the new index
+		__sync_synchronize();
+		writeIndex++;
+	}
+	T* beginRead() {
+		if(readIndex == writeIndex) {
+			return NULL;
+		}
+		__sync_synchronize();
+		return &slots[readIndex & mask];
+	}
+	// consumer side: drops every published slot but the newest and returns
+	// how many were dropped
+	unsigned int skipToNewest() {
+		unsigned int queued = writeIndex - readIndex;
+		if(queued < 2) {
+			return 0;
+		}
+		__sync_synchronize();
+		readIndex += queued - 1;
+		return queued - 1;
+	}
+	void endRead() {
+		__sync_synchronize();
+		readIndex++;
+	}
+	
+protected:
+	vector<T> slots;
+	unsigned int mask;
+	volatile unsigned int readIndex, writeIndex;
+};
@@ -0,0 +1,211 @@
+#include "FrameSource.h"
+#include "V4L2Source.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace ofxCv;
+using namespace cv;
+
+ImageSequenceSource::ImageSequenceSource()
+:position(0) {
+}
+
+bool ImageSequenceSource::open(string path) {
+	dir.allowExt("png");
+	dir.allowExt("jpg");
+	dir.allowExt("tif");
+	dir.allowExt("bmp");
+	dir.listDir(path);
+	dir.sort();
+	position = 0;
+	return dir.size() > 0;
+}
+
+bool ImageSequenceSource::read(Mat& frame) {
+	if(position >= dir.size()) {
+		return false;
+	}
+	if(!ofLoadImage(pixels, dir.getPath(position++))) {
+		return false;
+	}
+	frame = toCv(pixels);
+	return true;
+}
+
+int ImageSequenceSource::size() {
+	return dir.size();
+}
+
+VideoFileSource::VideoFileSource()
+:position(0) {
+}
+
+bool VideoFileSource::open(string path) {
+	player.setUseTexture(false);
+	if(!player.loadMovie(path)) {
+		return false;
+	}
+	player.setLoopState(OF_LOOP_NONE);
+	player.play();
+	player.setPaused(true);
+	position = 0;
+	return true;
+}
+
+bool VideoFileSource::read(Mat& frame) {
+	if(position >= size()) {
+		return false;
+	}
+	player.setFrame(position++);
+	player.update();
+	frame = toCv(player.getPixelsRef());
+	return true;
+}
+
+int VideoFileSource::size() {
+	return player.getTotalNumFrames();
+}
+
+float VideoFileSource::getFrameRate() {
+	float duration = player.getDuration();
+	return duration > 0 ? size() / duration : FrameSource::getFrameRate();
+}
+
+RecordingSource::RecordingSource()
+:position(0) {
+}
+
+bool RecordingSource::open(string path) {
+	position = 0;
+	return reader.open(path);
+}
+
+bool RecordingSource::read(Mat& frame) {
+	if(!reader.read(position++, recorded)) {
+		return false;
+	}
+	frame = recorded.image;
+	return true;
+}
+
+int RecordingSource::size() {
+	return reader.size();
+}
+
+RawFrameSource::RawFrameSource(int width, int height, int channels)
+:width(width)
+,height(height)
+,channels(channels)
+,frameBytes(width * height * channels)
+,fd(-1)
+,data(NULL)
+,length(0)
+,position(0) {
+}
+
+RawFrameSource::~RawFrameSource() {
+	close();
+}
+
+bool RawFrameSource::open(string path) {
+	close();
+	fd = path == "-" ? dup(STDIN_FILENO) : ::open(ofToDataPath(path).c_str(), O_RDONLY);
+	if(fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+		void* memory = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(memory != MAP_FAILED) {
+			data = (unsigned char*) memory;
+			length = info.st_size;
+			madvise(data, length, MADV_SEQUENTIAL);
+		}
+	}
+	if(data == NULL) {
+		buffer.resize(frameBytes);
+	}
+	position = 0;
+	return true;
+}
+
+void RawFrameSource::close() {
+	if(data != NULL) {
+		munmap(data, length);
+	}
+	if(fd >= 0) {
+		::close(fd);
+	}
+	data = NULL;
+	length = 0;
+	fd = -1;
+}
+
+bool RawFrameSource::read(Mat& frame) {
+	int type = CV_8UC(channels);
+	if(data != NULL) {
+		if((position + 1) * frameBytes > length) {
+			return false;
+		}
+		frame = Mat(height, width, type, data + position++ * frameBytes);
+		return true;
+	}
+	if(!readFully(&buffer[0], frameBytes)) {
+		return false;
+	}
+	position++;
+	frame = Mat(height, width, type, &buffer[0]);
+	return true;
+}
+
+// pipes return whatever has been written so far
+bool RawFrameSource::readFully(unsigned char* buffer, size_t length) {
+	while(length > 0) {
+		ssize_t count = ::read(fd, buffer, length);
+		if(count < 0 && errno == EINTR && !isStopping()) {
+			continue;
+		}
+		if(count <= 0) {
+			return false;
+		}
+		buffer += count;
+		length -= count;
+	}
+	return true;
+}
+
+int RawFrameSource::size() {
+	return length / frameBytes;
+}
+
+// a pipe is paced by whatever writes to it
+bool RawFrameSource::isLive() {
+	return data == NULL;
+}
+
+FrameSource* openFrameSource(string path, int width, int height) {
+	FrameSource* source;
+	string ext = ofFilePath::getFileExt(path);
+	if(path == "-" || ext == "gray") {
+		source = new RawFrameSource(width, height, 1);
+	} else if(ext == "rgb") {
+		source = new RawFrameSource(width, height, 3);
+	} else if(path.find("/dev/video") == 0) {
+		source = new V4L2Source(width, height);
+	} else if(ofDirectory(path).isDirectory()) {
+		source = new ImageSequenceSource();
+	} else if(ext == "hand") {
+		source = new RecordingSource();
+	} else {
+		source = new VideoFileSource();
+	}
+	if(!source->open(path)) {
+		ofLogError() << "couldn't open " << path;
+		delete source;
+		return NULL;
+	}
+	return source;
+}
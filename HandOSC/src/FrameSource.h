@@ -0,0 +1,121 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "Recording.h"
+#include <signal.h>
+
+// input for running HandProcessor without ofVideoGrabber.
+// a directory is read as an image sequence, a .hand file as a recording,
+// - or a .gray or .rgb file or pipe as raw frames, /dev/video* as a V4L2
+// camera and anything else as a video file.
+
+class FrameSource {
+public:
+	FrameSource()
+	:stopping(NULL) {
+	}
+	virtual ~FrameSource() {}
+	virtual bool open(string path) = 0;
+	// points frame at the next frame and returns true until the input runs
+	// out. frame may use memory owned by the source, which stays valid until
+	// the next read() and must not be written to.
+	virtual bool read(cv::Mat& frame) = 0;
+	// 0 when the length isn't known
+	virtual int size() = 0;
+	// frames per second when the recording doesn't know
+	virtual float getFrameRate() {
+		return 30;
+	}
+	// live sources deliver frames at their own pace, the others as fast as
+	// they're read
+	virtual bool isLive() {
+		return false;
+	}
+	// getMonotonicMicros() when the last frame was captured
+	virtual unsigned long long getCaptured() {
+		return getMonotonicMicros();
+	}
+	// frames the source threw away because read() wasn't called in time
+	virtual unsigned int getDroppedFrames() {
+		return 0;
+	}
+	// read() gives up waiting for a frame once *stopping is set, like from a
+	// signal handler installed without SA_RESTART
+	void setStopping(volatile sig_atomic_t* stopping) {
+		this->stopping = stopping;
+	}
+	bool isStopping() const {
+		return stopping != NULL && *stopping;
+	}
+protected:
+	volatile sig_atomic_t* stopping;
+};
+
+class ImageSequenceSource : public FrameSource {
+public:
+	ImageSequenceSource();
+	bool open(string path);
+	bool read(cv::Mat& frame);
+	int size();
+protected:
+	ofDirectory dir;
+	ofPixels pixels;
+	int position;
+};
+
+class VideoFileSource : public FrameSource {
+public:
+	VideoFileSource();
+	bool open(string path);
+	bool read(cv::Mat& frame);
+	int size();
+	float getFrameRate();
+protected:
+	ofVideoPlayer player;
+	int position;
+};
+
+// the frames of a recording, ignoring its parameters. mask recordings give
+// the masks, which background subtraction will mostly pass through.
+class RecordingSource : public FrameSource {
+public:
+	RecordingSource();
+	bool open(string path);
+	bool read(cv::Mat& frame);
+	int size();
+protected:
+	RecordingReader reader;
+	RecordedFrame recorded;
+	int position;
+};
+
+// fixed size 8-bit frames back to back with no header, like the output of
+// ffmpeg -f rawvideo -pix_fmt gray. regular files are memory mapped and
+// read in place, pipes are read into one reused buffer.
+class RawFrameSource : public FrameSource {
+public:
+	RawFrameSource(int width, int height, int channels = 1);
+	~RawFrameSource();
+	// - reads standard input
+	bool open(string path);
+	void close();
+	bool read(cv::Mat& frame);
+	int size();
+	bool isLive();
+protected:
+	bool readFully(unsigned char* buffer, size_t length);
+
+	int width, height, channels;
+	size_t frameBytes;
+	int fd;
+	// the whole file when it could be mapped
+	unsigned char* data;
+	size_t length;
+	int position;
+	vector<unsigned char> buffer;
+};
+
+// returns NULL if nothing could be opened at path. width and height are
+// requested from cameras and needed for raw frames.
+FrameSource* openFrameSource(string path, int width = 640, int height = 480);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "ofMain.h"
+
+// types shared by every stage of the hand pipeline
+
+enum HandStage {
+	STAGE_BACKGROUND = 0,
+	STAGE_CONTOURS,
+	STAGE_RESAMPLE,
+	STAGE_CURVATURE,
+	STAGE_PEAKS,
+	STAGE_FINGERS,
+	STAGE_TRACKING,
+	STAGE_COUNT
+};
+
+string getStageName(int stage);
+
+// microseconds from a clock that never jumps, used for every timestamp in
+// the pipeline so latencies can be compared across threads
+unsigned long long getMonotonicMicros();
+
+class HandSettings {
+public:
+	HandSettings()
+	:threshold(64)
+	,smoothing(10)
+	,sampleOffset(60)
+	,peakAngleCutoff(45)
+	,peakNeighborDistance(60)
+	,padding(8)
+	,multiHand(false)
+	,minHandArea(4000)
+	,tracking(false)
+	,largestBlob(false)
+	,hullFingers(false)
+	,minDefectDepth(20)
+	,predictionLatency(0) {
+	}
+	float threshold, smoothing, sampleOffset, peakAngleCutoff, peakNeighborDistance;
+	int padding;
+	// analyze every contour of at least minHandArea pixels instead of only the largest
+	bool multiHand;
+	float minHandArea;
+	// only process the full resolution frame around the hands, see TrackedBackground
+	bool tracking;
+	// with a single hand, only trace the largest blob, see LargestBlob
+	bool largestBlob;
+	// find fingertips from convexity defects of the raw contour instead of
+	// its curvature, see HullDetector. peakNeighborDistance still applies.
+	bool hullFingers;
+	float minDefectDepth;
+	// milliseconds to predict fingertips ahead, on top of the measured
+	// time from capture to output. use it for latency after HandOSC.
+	float predictionLatency;
+};
+
+// the sliders and toggles of HandSettings by their member names, as used
+// by batch sweeps, settings.xml and OSC. return NULL for unknown names.
+float* getSetting(HandSettings& settings, string name);
+bool* getToggle(HandSettings& settings, string name);
+const vector<string>& getSettingNames();
+const vector<string>& getToggleNames();
+
+class TrackedFinger {
+public:
+	// stays the same while the finger is tracked
+	unsigned int id;
+	ofVec2f position, velocity, predicted;
+};
+
+class Hand {
+public:
+	Hand()
+	:id(0)
+	,area(0) {
+	}
+	// persistent across frames, from the ContourFinder tracker
+	unsigned int id;
+	float area;
+	ofVec2f centroid;
+	ofPolyline contour, resampled;
+	vector<float> curvature;
+	// indices into resampled, or into contour with hullFingers
+	vector<int> peaks, valleys;
+	vector<ofVec2f> fingers;
+	vector<TrackedFinger> trackedFingers;
+};
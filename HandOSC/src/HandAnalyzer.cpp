@@ -0,0 +1,121 @@
+#include "HandAnalyzer.h"
+
+vector<float> buildContourAnalysis(ofPolyline& polyline, int offset) {
+	int n = polyline.size();
+	if(offset > n) {
+		offset = n;
+	}
+	vector<float> curvature(n);
+	for(int i = 0; i < n; i++) {
+		int left = i - offset;
+		if(left < 0) {
+			left += n;
+		}
+		int right = i + offset;
+		if(right >= n) {
+			right -= n;
+		}
+		ofVec2f a = polyline[left], b = polyline[i], c = polyline[right];
+		a -= b;
+		c -= b;
+		float angle = a.angle(c);
+		curvature[i] = -(angle > 0 ? angle - 180 : angle + 180);
+	}
+	return curvature;
+}
+
+vector<int> findPeaks(vector<float>& values, float cutoff, int peakArea) {
+	vector< pair<float, int> > peaks;
+	int n = values.size();
+	for(int i = 1; i < n - 1; i++) {
+		if(values[i] > cutoff) {
+			peaks.push_back(pair<float, int>(-values[i], i));
+		}
+	}
+	ofSort(peaks);
+	vector<int> indices;
+	for(int i = 0; i < peaks.size(); i++) {
+		int curIndex = peaks[i].second;
+		bool hasNeighbor = false;
+		for(int j = 0; j < indices.size(); j++) {
+			if(abs(curIndex - indices[j]) < peakArea || abs((curIndex + n) - indices[j]) < peakArea) {
+				hasNeighbor = true;
+				break;
+			}
+		}
+		if(!hasNeighbor) {
+			indices.push_back(curIndex);
+		}
+	}
+	return indices;
+}
+
+HandAnalyzer::HandAnalyzer() {
+	resetStageMicros();
+}
+
+void HandAnalyzer::analyze(Hand& hand, const HandSettings& settings, int height) {
+	lastLap = getMonotonicMicros();
+	if(settings.hullFingers) {
+		// the whole detector counts as the peaks stage
+		detectHull(hand, settings);
+		lap(STAGE_PEAKS);
+	} else {
+		hand.valleys.clear();
+		resample(hand, settings);
+		lap(STAGE_RESAMPLE);
+		analyzeCurvature(hand, settings);
+		lap(STAGE_CURVATURE);
+		detectPeaks(hand, settings);
+		lap(STAGE_PEAKS);
+	}
+	filterFingertips(hand, settings, height);
+	lap(STAGE_FINGERS);
+}
+
+void HandAnalyzer::resample(Hand& hand, const HandSettings& settings) {
+	conditioner.update(hand.contour, 1, settings.smoothing, hand.resampled);
+}
+
+void HandAnalyzer::analyzeCurvature(Hand& hand, const HandSettings& settings) {
+	curvature.update(hand.resampled, settings.sampleOffset, hand.curvature);
+}
+
+void HandAnalyzer::detectPeaks(Hand& hand, const HandSettings& settings) {
+	peakDetector.find(hand.curvature, settings.peakAngleCutoff, settings.peakNeighborDistance, hand.peaks);
+}
+
+void HandAnalyzer::detectHull(Hand& hand, const HandSettings& settings) {
+	hand.resampled.clear();
+	hand.curvature.clear();
+	hullDetector.find(hand.contour, settings.minDefectDepth, settings.peakNeighborDistance, hand.peaks, hand.valleys);
+}
+
+void HandAnalyzer::filterFingertips(Hand& hand, const HandSettings& settings, int height) {
+	// ignore anything touching the bottom edge, where the arm enters the frame
+	int bottom = height - settings.padding;
+	const ofPolyline& outline = settings.hullFingers ? hand.contour : hand.resampled;
+	hand.fingers.clear();
+	for(int i = 0; i < hand.peaks.size(); i++) {
+		ofVec2f finger = outline[hand.peaks[i]];
+		if(finger.y < bottom) {
+			hand.fingers.push_back(finger);
+		}
+	}
+}
+
+void HandAnalyzer::resetStageMicros() {
+	for(int i = 0; i < STAGE_COUNT; i++) {
+		stageMicros[i] = 0;
+	}
+}
+
+unsigned long long HandAnalyzer::getStageMicros(int stage) const {
+	return stageMicros[stage];
+}
+
+void HandAnalyzer::lap(int stage) {
+	unsigned long long now = getMonotonicMicros();
+	stageMicros[stage] = MAX(stageMicros[stage], now - lastLap);
+	lastLap = now;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Hand.h"
+#include "ContourConditioner.h"
+#include "Curvature.h"
+#include "PeakDetector.h"
+#include "HullDetector.h"
+
+// the original scalar implementations, kept as a reference for the faster stages
+vector<float> buildContourAnalysis(ofPolyline& polyline, int offset);
+vector<int> findPeaks(vector<float>& values, float cutoff, int peakArea);
+
+// the per-hand stages, from a raw contour to fingertips. keeps its own
+// scratch buffers, so use one analyzer per thread.
+class HandAnalyzer {
+public:
+	HandAnalyzer();
+	
+	// runs every stage on hand.contour. fingertips closer than
+	// settings.padding to the bottom of a frame of this height are dropped.
+	void analyze(Hand& hand, const HandSettings& settings, int height);
+	// with settings.hullFingers, in place of resample, curvature and peaks
+	void detectHull(Hand& hand, const HandSettings& settings);
+	
+	void resample(Hand& hand, const HandSettings& settings);
+	void analyzeCurvature(Hand& hand, const HandSettings& settings);
+	void detectPeaks(Hand& hand, const HandSettings& settings);
+	void filterFingertips(Hand& hand, const HandSettings& settings, int height);
+	
+	// the slowest time for each stage since the last resetStageMicros()
+	void resetStageMicros();
+	unsigned long long getStageMicros(int stage) const;
+	
+protected:
+	void lap(int stage);
+	
+	ContourConditioner conditioner;
+	Curvature curvature;
+	PeakDetector peakDetector;
+	HullDetector hullDetector;
+	unsigned long long stageMicros[STAGE_COUNT], lastLap;
+};
@@ -0,0 +1,217 @@
+#include "HandOsc.h"
+#include <sys/time.h>
+
+// the largest payload that fits in a single UDP datagram
+static const int maxPacketSize = 65507;
+// seconds from the NTP epoch (1900) to the unix epoch (1970)
+static const unsigned long long ntpUnixOffset = 2208988800ULL;
+
+void HandAddresses::setup(string prefix) {
+	this->prefix = prefix;
+	size = prefix + "/size";
+	position = prefix + "/position";
+	fingers.clear();
+}
+
+const char* HandAddresses::getFinger(int i) {
+	while(fingers.size() <= i) {
+		fingers.push_back(prefix + "/finger/" + ofToString(fingers.size()));
+	}
+	return fingers[i].c_str();
+}
+
+HandOsc::HandOsc()
+:bundled(false)
+,socket(NULL)
+,log(NULL)
+,epochOffset(0) {
+}
+
+HandOsc::~HandOsc() {
+	delete socket;
+	if(log != NULL) {
+		fclose(log);
+	}
+}
+
+void HandOsc::setup(string host, int port, bool bundled) {
+	this->bundled = bundled;
+	if(!bundled) {
+		osc.setup(host, port);
+		return;
+	}
+	socket = new UdpTransmitSocket(IpEndpointName(host.c_str(), port));
+	socket->SetEnableBroadcast(true);
+	setupBundles();
+}
+
+bool HandOsc::setupLog(string path) {
+	log = fopen(ofToDataPath(path).c_str(), "wb");
+	if(log == NULL) {
+		ofLogError() << "couldn't create OSC log " << path;
+		return false;
+	}
+	bundled = true;
+	setupBundles();
+	return true;
+}
+
+void HandOsc::setupBundles() {
+	buffer.resize(maxPacketSize);
+	singleAddresses.setup("/hand");
+	
+	timeval now;
+	gettimeofday(&now, NULL);
+	epochOffset = now.tv_sec * 1000000ULL + now.tv_usec - getMonotonicMicros();
+}
+
+bool HandOsc::setupShared(string name) {
+	return shared.setup(name);
+}
+
+void HandOsc::send(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence) {
+	if(shared.isOpen()) {
+		shared.write(hands, multiHand, captured, sequence);
+	}
+	if(bundled) {
+		sendBundle(hands, multiHand, captured, sequence);
+		return;
+	}
+	if(hands.empty()) {
+		return;
+	}
+	if(multiHand) {
+		for(int i = 0; i < hands.size(); i++) {
+			sendMessages(hands[i], "/hand/" + ofToString(hands[i].id));
+		}
+	} else {
+		sendMessages(hands[0], "/hand");
+	}
+}
+
+void HandOsc::sendMessages(Hand& hand, string prefix) {
+	ofxOscMessage handSize;
+	handSize.setAddress(prefix + "/size");
+	handSize.addFloatArg(sqrtf(hand.area));
+	osc.sendMessage(handSize);
+	
+	ofxOscMessage handPosition;
+	handPosition.setAddress(prefix + "/position");
+	handPosition.addFloatArg(hand.centroid.x);
+	handPosition.addFloatArg(hand.centroid.y);
+	osc.sendMessage(handPosition);
+	
+	for(int i = 0; i < hand.trackedFingers.size(); i++) {
+		TrackedFinger& finger = hand.trackedFingers[i];
+		ofxOscMessage fingerPosition;
+		fingerPosition.setAddress(prefix + "/finger/" + ofToString(finger.id));
+		fingerPosition.addFloatArg(finger.predicted.x);
+		fingerPosition.addFloatArg(finger.predicted.y);
+		osc.sendMessage(fingerPosition);
+	}
+}
+
+void HandOsc::sendBundle(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence) {
+	unsigned long long micros = captured + epochOffset;
+	unsigned long long seconds = micros / 1000000 + ntpUnixOffset;
+	unsigned long long fraction = ((micros % 1000000) << 32) / 1000000;
+	osc::uint64 timeTag = (seconds << 32) | fraction;
+	
+	osc::OutboundPacketStream packet(&buffer[0], buffer.size());
+	try {
+		packet << osc::BeginBundle(timeTag);
+		packet << osc::BeginMessage("/hand/frame") << (osc::int32) sequence << osc::EndMessage;
+		int n = multiHand ? hands.size() : MIN(hands.size(), 1);
+		if(multiHand) {
+			forgetAddresses(hands);
+		}
+		for(int i = 0; i < n; i++) {
+			Hand& hand = hands[i];
+			HandAddresses& addresses = getAddresses(hand, multiHand);
+			packet << osc::BeginMessage(addresses.size.c_str()) << sqrtf(hand.area) << osc::EndMessage;
+			packet << osc::BeginMessage(addresses.position.c_str()) << hand.centroid.x << hand.centroid.y << osc::EndMessage;
+			for(int j = 0; j < hand.trackedFingers.size(); j++) {
+				TrackedFinger& finger = hand.trackedFingers[j];
+				packet << osc::BeginMessage(addresses.getFinger(finger.id)) << finger.predicted.x << finger.predicted.y << osc::EndMessage;
+			}
+		}
+		packet << osc::EndBundle;
+	} catch(osc::OutOfBufferMemoryException& e) {
+		ofLogWarning() << "frame " << sequence << " is too large for one OSC bundle, dropping it";
+		return;
+	}
+	write(packet);
+}
+
+void HandOsc::write(osc::OutboundPacketStream& packet) {
+	if(socket != NULL) {
+		socket->Send(packet.Data(), packet.Size());
+	}
+	if(log != NULL) {
+		// stream framing from OSC 1.0: a big endian size before each packet
+		unsigned int size = packet.Size();
+		unsigned char header[4] = {
+			(unsigned char) (size >> 24), (unsigned char) (size >> 16),
+			(unsigned char) (size >> 8), (unsigned char) size};
+		fwrite(header, 1, sizeof(header), log);
+		fwrite(packet.Data(), 1, size, log);
+	}
+}
+
+void HandOsc::sendStats(const StatsSummary& summary) {
+	if(!bundled) {
+		ofxOscMessage stats;
+		stats.setAddress("/stats");
+		stats.addFloatArg(summary.time);
+		stats.addFloatArg(summary.fps);
+		stats.addIntArg(summary.frames);
+		stats.addIntArg(summary.dropped);
+		for(int i = 0; i < STAT_COUNT; i++) {
+			stats.addStringArg(getStatName(i));
+			stats.addIntArg(summary.p50[i]);
+			stats.addIntArg(summary.p99[i]);
+			stats.addIntArg(summary.max[i]);
+		}
+		osc.sendMessage(stats);
+		return;
+	}
+	osc::OutboundPacketStream packet(&buffer[0], buffer.size());
+	packet << osc::BeginMessage("/stats") << summary.time << summary.fps
+		<< (osc::int32) summary.frames << (osc::int32) summary.dropped;
+	for(int i = 0; i < STAT_COUNT; i++) {
+		packet << getStatName(i).c_str()
+			<< (osc::int32) summary.p50[i]
+			<< (osc::int32) summary.p99[i]
+			<< (osc::int32) summary.max[i];
+	}
+	packet << osc::EndMessage;
+	write(packet);
+}
+
+// hand ids only ever grow, so the addresses of hands that have gone are
+// dropped rather than kept for an id that won't come back
+void HandOsc::forgetAddresses(vector<Hand>& hands) {
+	for(map<unsigned int, HandAddresses>::iterator itr = multiAddresses.begin(); itr != multiAddresses.end();) {
+		bool found = false;
+		for(int i = 0; i < hands.size() && !found; i++) {
+			found = hands[i].id == itr->first;
+		}
+		if(found) {
+			itr++;
+		} else {
+			multiAddresses.erase(itr++);
+		}
+	}
+}
+
+HandAddresses& HandOsc::getAddresses(Hand& hand, bool multiHand) {
+	if(!multiHand) {
+		return singleAddresses;
+	}
+	map<unsigned int, HandAddresses>::iterator itr = multiAddresses.find(hand.id);
+	if(itr == multiAddresses.end()) {
+		itr = multiAddresses.insert(make_pair(hand.id, HandAddresses())).first;
+		itr->second.setup("/hand/" + ofToString(hand.id));
+	}
+	return itr->second;
+}
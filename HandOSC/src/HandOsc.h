@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ofxOsc.h"
+#include "OscOutboundPacketStream.h"
+#include "UdpSocket.h"
+#include "Hand.h"
+#include "HandStats.h"
+#include "SharedHandsWriter.h"
+
+// the addresses for one hand, built once and reused every frame
+class HandAddresses {
+public:
+	void setup(string prefix);
+	const char* getFinger(int i);
+	
+	string size, position;
+	
+protected:
+	string prefix;
+	vector<string> fingers;
+};
+
+// sends hands as /hand/... for a single hand, or /hand/<id>/... for many.
+// fingers are sent by their tracked id with their predicted position.
+// in bundled mode each frame goes out as one OSC bundle, timetagged with
+// the capture time and led by /hand/frame <sequence> so receivers can spot
+// dropped frames. the bundle is encoded into a buffer allocated at setup,
+// so once every hand id and finger count has been seen nothing allocates.
+// with setupShared() every frame is also written to shared memory first,
+// for consumers on the same machine.
+class HandOsc {
+public:
+	HandOsc();
+	~HandOsc();
+	
+	void setup(string host, int port, bool bundled = false);
+	bool setupShared(string name = SHARED_HANDS_NAME);
+	// writes bundles to a file instead of sending them, for offline runs
+	bool setupLog(string path);
+	// captured is getMonotonicMicros() when the frame arrived
+	void send(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence);
+	// sends /stats time fps frames dropped, then name p50 p99 max for every
+	// stat, with durations in microseconds
+	void sendStats(const StatsSummary& summary);
+	
+protected:
+	void sendMessages(Hand& hand, string prefix);
+	void sendBundle(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence);
+	void forgetAddresses(vector<Hand>& hands);
+	HandAddresses& getAddresses(Hand& hand, bool multiHand);
+	void setupBundles();
+	void write(osc::OutboundPacketStream& packet);
+	
+	bool bundled;
+	ofxOscSender osc;
+	UdpTransmitSocket* socket;
+	FILE* log;
+	vector<char> buffer;
+	// added to getMonotonicMicros() to get microseconds since 1970
+	unsigned long long epochOffset;
+	HandAddresses singleAddresses;
+	map<unsigned int, HandAddresses> multiAddresses;
+	SharedHandsWriter shared;
+};
@@ -0,0 +1,151 @@
+#include "HandPipeline.h"
+
+using namespace ofxCv;
+using namespace cv;
+
+void HandResult::swap(HandResult& other) {
+	cv::swap(frame, other.frame);
+	cv::swap(thresholded, other.thresholded);
+	hands.swap(other.hands);
+	std::swap(captured, other.captured);
+	std::swap(processed, other.processed);
+	std::swap(sequence, other.sequence);
+}
+
+CaptureThread::CaptureThread()
+:ring(NULL)
+,frameReady(NULL)
+,sequence(0)
+,dropped(0) {
+}
+
+void CaptureThread::setup(int width, int height, FrameRing<Frame>& ring, Poco::Event& frameReady) {
+	this->ring = &ring;
+	this->frameReady = &frameReady;
+	for(int i = 0; i < ring.size(); i++) {
+		ring[i].image.create(height, width, CV_8UC3);
+	}
+	cam.setUseTexture(false);
+	cam.initGrabber(width, height);
+	startThread(true, false);
+}
+
+unsigned int CaptureThread::getDroppedFrames() const {
+	return dropped;
+}
+
+void CaptureThread::threadedFunction() {
+	while(isThreadRunning()) {
+		cam.update();
+		if(!cam.isFrameNew()) {
+			ofSleepMillis(1);
+			continue;
+		}
+		unsigned long long captured = getMonotonicMicros();
+		Frame* frame = ring->beginWrite();
+		if(frame == NULL) {
+			dropped++;
+			continue;
+		}
+		toCv(cam).copyTo(frame->image);
+		frame->captured = captured;
+		frame->sequence = sequence++;
+		ring->endWrite();
+		frameReady->set();
+	}
+}
+
+HandPipeline::HandPipeline()
+:osc(NULL)
+,stats(NULL)
+,recorder(NULL)
+,hasLatest(false)
+,resetRequested(false)
+,skipped(0) {
+}
+
+HandPipeline::~HandPipeline() {
+	stop();
+}
+
+void HandPipeline::setup(int width, int height, HandOsc& osc, HandStats& stats, RecordingWriter& recorder, int ringSize) {
+	this->osc = &osc;
+	this->stats = &stats;
+	this->recorder = &recorder;
+	ring.setup(ringSize);
+	capture.setup(width, height, ring, frameReady);
+	startThread(true, false);
+}
+
+void HandPipeline::stop() {
+	if(capture.isThreadRunning()) {
+		capture.waitForThread(true);
+	}
+	if(isThreadRunning()) {
+		waitForThread(true);
+	}
+}
+
+bool HandPipeline::update() {
+	ofScopedLock lock(resultMutex);
+	if(!hasLatest) {
+		return false;
+	}
+	shown.swap(latest);
+	hasLatest = false;
+	return true;
+}
+
+HandResult& HandPipeline::getResult() {
+	return shown;
+}
+
+HandSettings& HandPipeline::getSettings() {
+	return processor.settings;
+}
+
+void HandPipeline::reset() {
+	resetRequested = true;
+}
+
+unsigned int HandPipeline::getDroppedFrames() const {
+	return capture.getDroppedFrames() + skipped;
+}
+
+void HandPipeline::threadedFunction() {
+	while(isThreadRunning()) {
+		skipped += ring.skipToNewest();
+		Frame* frame = ring.beginRead();
+		if(frame == NULL) {
+			frameReady.tryWait(100);
+			continue;
+		}
+		if(resetRequested) {
+			processor.reset();
+			resetRequested = false;
+		}
+		FrameTimes times;
+		times.captured = frame->captured;
+		times.started = getMonotonicMicros();
+		recorder->update(processor, frame->image, frame->captured, frame->sequence);
+		times.processed = getMonotonicMicros();
+		osc->send(processor.getHands(), processor.settings.multiHand, frame->captured, frame->sequence);
+		times.sent = getMonotonicMicros();
+		stats->add(processor, times);
+		if(stats->update(getDroppedFrames())) {
+			osc->sendStats(stats->getSummary());
+		}
+		
+		frame->image.copyTo(pending.frame);
+		processor.getThresholded().copyTo(pending.thresholded);
+		pending.hands = processor.getHands();
+		pending.captured = frame->captured;
+		pending.processed = times.processed;
+		pending.sequence = frame->sequence;
+		ring.endRead();
+		
+		ofScopedLock lock(resultMutex);
+		latest.swap(pending);
+		hasLatest = true;
+	}
+}
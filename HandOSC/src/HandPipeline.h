@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "Poco/Event.h"
+#include "FrameRing.h"
+#include "HandProcessor.h"
+#include "HandOsc.h"
+#include "HandStats.h"
+#include "Recording.h"
+
+class Frame {
+public:
+	Frame()
+	:captured(0)
+	,sequence(0) {
+	}
+	cv::Mat image;
+	unsigned long long captured;
+	unsigned int sequence;
+};
+
+// everything the render thread needs to draw one processed frame
+class HandResult {
+public:
+	HandResult()
+	:captured(0)
+	,processed(0)
+	,sequence(0) {
+	}
+	void swap(HandResult& other);
+	
+	cv::Mat frame, thresholded;
+	vector<Hand> hands;
+	unsigned long long captured, processed;
+	unsigned int sequence;
+};
+
+// owns the camera and pushes every new frame into the ring, or counts it
+// as dropped when the ring is full
+class CaptureThread : public ofThread {
+public:
+	CaptureThread();
+	void setup(int width, int height, FrameRing<Frame>& ring, Poco::Event& frameReady);
+	unsigned int getDroppedFrames() const;
+	
+protected:
+	void threadedFunction();
+	
+	ofVideoGrabber cam;
+	FrameRing<Frame>* ring;
+	Poco::Event* frameReady;
+	unsigned int sequence;
+	volatile unsigned int dropped;
+};
+
+// runs capture, processing and rendering on separate threads. frames go
+// from the capture thread to the processing thread through a lock-free
+// ring, processing always skips to the newest frame in it so latency
+// doesn't build up when it falls behind, OSC is sent as soon as a frame is
+// processed, and the render thread only ever picks up the latest result.
+class HandPipeline : public ofThread {
+public:
+	HandPipeline();
+	~HandPipeline();
+	
+	void setup(int width, int height, HandOsc& osc, HandStats& stats, RecordingWriter& recorder, int ringSize = 4);
+	void stop();
+	
+	// call from the render thread, returns true if there's a new result
+	bool update();
+	HandResult& getResult();
+	// settings can be changed from any thread
+	HandSettings& getSettings();
+	void reset();
+	unsigned int getDroppedFrames() const;
+	
+protected:
+	void threadedFunction();
+	
+	CaptureThread capture;
+	FrameRing<Frame> ring;
+	Poco::Event frameReady;
+	HandProcessor processor;
+	HandOsc* osc;
+	HandStats* stats;
+	RecordingWriter* recorder;
+	
+	// processing fills pending then swaps it with latest, rendering swaps
+	// latest with shown, so the lock is only held for a swap
+	ofMutex resultMutex;
+	HandResult pending, latest, shown;
+	bool hasLatest;
+	volatile bool resetRequested;
+	// frames skipped for a newer one
+	volatile unsigned int skipped;
+};
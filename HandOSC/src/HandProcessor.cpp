@@ -0,0 +1,381 @@
+#include "HandProcessor.h"
+
+#ifdef TARGET_OSX
+#include <mach/mach_time.h>
+#endif
+
+using namespace ofxCv;
+using namespace cv;
+
+string getStageName(int stage) {
+	switch(stage) {
+		case STAGE_BACKGROUND: return "background";
+		case STAGE_CONTOURS: return "contours";
+		case STAGE_RESAMPLE: return "resample";
+		case STAGE_CURVATURE: return "curvature";
+		case STAGE_PEAKS: return "peaks";
+		case STAGE_FINGERS: return "fingers";
+		case STAGE_TRACKING: return "tracking";
+	}
+	return "unknown";
+}
+
+unsigned long long getMonotonicMicros() {
+#if defined(TARGET_OSX)
+	static mach_timebase_info_data_t timebase;
+	if(timebase.denom == 0) {
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#elif defined(TARGET_WIN32)
+	return ofGetElapsedTimeMicros();
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+#endif
+}
+
+static const char* settingNames[] = {
+	"threshold", "smoothing", "sampleOffset", "peakAngleCutoff", "peakNeighborDistance",
+	"minHandArea", "minDefectDepth", "predictionLatency"
+};
+static const char* toggleNames[] = {
+	"multiHand", "tracking", "largestBlob", "hullFingers"
+};
+
+float* getSetting(HandSettings& settings, string name) {
+	if(name == "threshold") return &settings.threshold;
+	if(name == "smoothing") return &settings.smoothing;
+	if(name == "sampleOffset") return &settings.sampleOffset;
+	if(name == "peakAngleCutoff") return &settings.peakAngleCutoff;
+	if(name == "peakNeighborDistance") return &settings.peakNeighborDistance;
+	if(name == "minHandArea") return &settings.minHandArea;
+	if(name == "minDefectDepth") return &settings.minDefectDepth;
+	if(name == "predictionLatency") return &settings.predictionLatency;
+	return NULL;
+}
+
+bool* getToggle(HandSettings& settings, string name) {
+	if(name == "multiHand") return &settings.multiHand;
+	if(name == "tracking") return &settings.tracking;
+	if(name == "largestBlob") return &settings.largestBlob;
+	if(name == "hullFingers") return &settings.hullFingers;
+	return NULL;
+}
+
+const vector<string>& getSettingNames() {
+	static vector<string> names(settingNames, settingNames + sizeof(settingNames) / sizeof(settingNames[0]));
+	return names;
+}
+
+const vector<string>& getToggleNames() {
+	static vector<string> names(toggleNames, toggleNames + sizeof(toggleNames) / sizeof(toggleNames[0]));
+	return names;
+}
+
+// contours outside this range are never considered
+static const float minContourRadius = 10;
+static const float maxContourRadius = 400;
+
+HandProcessor::HandProcessor()
+:latency(0) {
+	contourFinder.setMinAreaRadius(minContourRadius);
+	contourFinder.setMaxAreaRadius(maxContourRadius);
+	trackedBackground.setMinArea(PI * minContourRadius * minContourRadius);
+	wasTracking = settings.tracking;
+	for(int i = 0; i < STAGE_COUNT; i++) {
+		stageMicros[i] = 0;
+	}
+}
+
+bool HandProcessor::update(Mat frame, unsigned long long captured) {
+	captured = startFrame(captured);
+	subtractBackground(frame);
+	lap(STAGE_BACKGROUND);
+	return processThresholded(captured);
+}
+
+bool HandProcessor::updateThresholded(Mat mask, unsigned long long captured) {
+	captured = startFrame(captured);
+	mask.copyTo(thresholded);
+	lap(STAGE_BACKGROUND);
+	return processThresholded(captured);
+}
+
+// returns the capture time, which is now if it wasn't given
+unsigned long long HandProcessor::startFrame(unsigned long long captured) {
+	for(int i = 0; i < STAGE_COUNT; i++) {
+		stageMicros[i] = 0;
+	}
+	lastLap = getMonotonicMicros();
+	return captured == 0 ? lastLap : captured;
+}
+
+bool HandProcessor::processThresholded(unsigned long long captured) {
+	bool found = findContours();
+	lap(STAGE_CONTOURS);
+	if(found) {
+		analyzeHands();
+	}
+	// also runs without hands, so trackers of hands that left are dropped
+	lastLap = getMonotonicMicros();
+	measureLatency(captured);
+	trackFingers(captured, latency + settings.predictionLatency / 1000);
+	lap(STAGE_TRACKING);
+	return found;
+}
+
+bool HandProcessor::analyze(Mat mask) {
+	mask.copyTo(thresholded);
+	bool found = findContours();
+	if(found) {
+		analyzeHands();
+	}
+	return found;
+}
+
+// live frames take their ids from the contour finder, here the order of
+// the frames isn't known until now so the ids are tracked from scratch
+void HandProcessor::track(vector<Hand>& hands, unsigned long long captured) {
+	roiRects.clear();
+	for(int i = 0; i < hands.size(); i++) {
+		roiRects.push_back(toCv(hands[i].contour.getBoundingBox()));
+	}
+	const vector<unsigned int>& labels = roiTracker.track(roiRects);
+	for(int i = 0; i < hands.size(); i++) {
+		hands[i].id = labels[i];
+	}
+	this->hands.swap(hands);
+	trackFingers(captured, settings.predictionLatency / 1000);
+	this->hands.swap(hands);
+}
+
+void HandProcessor::setThreads(int threads) {
+	pool.setup(threads);
+}
+
+void HandProcessor::lap(int stage) {
+	unsigned long long now = getMonotonicMicros();
+	stageMicros[stage] = now - lastLap;
+	lastLap = now;
+}
+
+void HandProcessor::reset() {
+	runningBackground.reset();
+	trackedBackground.reset();
+}
+
+void HandProcessor::subtractBackground(Mat frame) {
+	// neither background learned anything while the other was in use, and
+	// each leaves its own mask behind
+	if(settings.tracking != wasTracking) {
+		reset();
+		wasTracking = settings.tracking;
+	}
+	if(settings.tracking) {
+		trackedBackground.update(frame, thresholded, settings.threshold);
+	} else {
+		runningBackground.setThresholdValue(settings.threshold);
+		runningBackground.update(frame, thresholded);
+	}
+}
+
+// sort contours from largest to smallest, keeping either the largest or
+// everything big enough to be a hand
+void HandProcessor::selectHands(vector< pair<float, int> >& areas) {
+	ofSort(areas);
+	if(!settings.multiHand && areas.size() > 1) {
+		areas.resize(1);
+	}
+	hands.resize(areas.size());
+}
+
+bool HandProcessor::isHandArea(float area) const {
+	return !settings.multiHand || area >= settings.minHandArea;
+}
+
+bool HandProcessor::findContours() {
+	if(settings.largestBlob && !settings.multiHand) {
+		return findLargestBlob();
+	}
+	if(settings.tracking) {
+		return findContoursInRoi();
+	}
+	
+	contourFinder.findContours(thresholded);
+	areas.clear();
+	for(int i = 0; i < contourFinder.size(); i++) {
+		float curArea = contourFinder.getContourArea(i);
+		if(isHandArea(curArea)) {
+			areas.push_back(pair<float, int>(-curArea, i));
+		}
+	}
+	selectHands(areas);
+	for(int i = 0; i < areas.size(); i++) {
+		Hand& hand = hands[i];
+		int index = areas[i].second;
+		hand.id = contourFinder.getLabel(index);
+		hand.area = -areas[i].first;
+		hand.centroid = toOf(contourFinder.getCentroid(index));
+		hand.contour = contourFinder.getPolyline(index);
+	}
+	return !hands.empty();
+}
+
+// like findContours(), but only traces the tracked roi and offsets the
+// contours back into frame coordinates
+bool HandProcessor::findContoursInRoi() {
+	Rect roi = trackedBackground.getRoi();
+	thresholded(roi).copyTo(roiMask);
+	cv::findContours(roiMask, roiContours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_NONE, roi.tl());
+	
+	float minArea = PI * minContourRadius * minContourRadius;
+	float maxArea = PI * maxContourRadius * maxContourRadius;
+	areas.clear();
+	roiRects.clear();
+	roiIndices.clear();
+	for(int i = 0; i < roiContours.size(); i++) {
+		float curArea = contourArea(roiContours[i]);
+		if(curArea < minArea || curArea > maxArea) {
+			continue;
+		}
+		if(isHandArea(curArea)) {
+			areas.push_back(pair<float, int>(-curArea, roiRects.size()));
+		}
+		roiRects.push_back(boundingRect(roiContours[i]));
+		roiIndices.push_back(i);
+	}
+	const vector<unsigned int>& labels = roiTracker.track(roiRects);
+	selectHands(areas);
+	
+	Rect bounds;
+	for(int i = 0; i < areas.size(); i++) {
+		Hand& hand = hands[i];
+		int index = areas[i].second;
+		const vector<cv::Point>& contour = roiContours[roiIndices[index]];
+		Moments m = moments(contour);
+		hand.id = labels[index];
+		hand.area = -areas[i].first;
+		hand.centroid.set(m.m10 / m.m00, m.m01 / m.m00);
+		hand.contour.clear();
+		for(int j = 0; j < contour.size(); j++) {
+			hand.contour.addVertex(contour[j].x, contour[j].y);
+		}
+		hand.contour.close();
+		bounds = i == 0 ? roiRects[index] : (bounds | roiRects[index]);
+	}
+	trackedBackground.track(bounds);
+	return !hands.empty();
+}
+
+// gives the same hand as findContours() with a single hand, but only
+// traces the largest blob
+bool HandProcessor::findLargestBlob() {
+	Rect roi = settings.tracking ? trackedBackground.getRoi() : Rect(0, 0, thresholded.cols, thresholded.rows);
+	float minArea = PI * minContourRadius * minContourRadius;
+	float maxArea = PI * maxContourRadius * maxContourRadius;
+	roiRects.clear();
+	if(largestBlob.find(thresholded, roi, minArea, maxArea)) {
+		roiRects.push_back(largestBlob.getBounds());
+	}
+	const vector<unsigned int>& labels = roiTracker.track(roiRects);
+	hands.resize(roiRects.size());
+	
+	Rect bounds;
+	if(!hands.empty()) {
+		// area and centroid from the outline, like ContourFinder
+		const vector<cv::Point>& contour = largestBlob.getContour();
+		Moments m = moments(contour);
+		Hand& hand = hands[0];
+		hand.id = labels[0];
+		hand.area = contourArea(contour);
+		hand.centroid.set(m.m10 / m.m00, m.m01 / m.m00);
+		hand.contour.clear();
+		for(int i = 0; i < contour.size(); i++) {
+			hand.contour.addVertex(contour[i].x, contour[i].y);
+		}
+		hand.contour.close();
+		bounds = roiRects[0];
+	}
+	if(settings.tracking) {
+		trackedBackground.track(bounds);
+	}
+	return !hands.empty();
+}
+
+void HandProcessor::analyzeHands() {
+	if(settings.multiHand) {
+		if(!pool.isSetup()) {
+			pool.setup();
+		}
+		pool.analyze(hands, settings, thresholded.rows);
+		for(int i = STAGE_RESAMPLE; i <= STAGE_FINGERS; i++) {
+			stageMicros[i] = pool.getStageMicros(i);
+		}
+	} else {
+		analyzer.resetStageMicros();
+		analyzer.analyze(hands[0], settings, thresholded.rows);
+		for(int i = STAGE_RESAMPLE; i <= STAGE_FINGERS; i++) {
+			stageMicros[i] = analyzer.getStageMicros(i);
+		}
+	}
+}
+
+// the time this frame has spent in the pipeline so far, smoothed
+void HandProcessor::measureLatency(unsigned long long captured) {
+	float curLatency = (getMonotonicMicros() - captured) / 1e6;
+	latency = latency == 0 ? curLatency : ofLerp(latency, curLatency, .1);
+}
+
+void HandProcessor::trackFingers(unsigned long long captured, float lookahead) {
+	// one tracker per hand id, forgetting hands that have gone
+	for(map<unsigned int, FingerTracker>::iterator itr = fingerTrackers.begin(); itr != fingerTrackers.end();) {
+		bool found = false;
+		for(int i = 0; i < hands.size() && !found; i++) {
+			found = getTrackerId(hands[i]) == itr->first;
+		}
+		if(found) {
+			itr++;
+		} else {
+			fingerTrackers.erase(itr++);
+		}
+	}
+	for(int i = 0; i < hands.size(); i++) {
+		FingerTracker& tracker = fingerTrackers[getTrackerId(hands[i])];
+		tracker.update(hands[i].fingers, captured, lookahead, hands[i].trackedFingers);
+	}
+}
+
+// a single hand keeps its fingers even if the contour tracker relabels it
+unsigned int HandProcessor::getTrackerId(const Hand& hand) const {
+	return settings.multiHand ? hand.id : 0;
+}
+
+float HandProcessor::getLatency() const {
+	return latency;
+}
+
+bool HandProcessor::hasHand() const {
+	return !hands.empty();
+}
+
+vector<Hand>& HandProcessor::getHands() {
+	return hands;
+}
+
+Mat& HandProcessor::getThresholded() {
+	return thresholded;
+}
+
+ContourFinder& HandProcessor::getContourFinder() {
+	return contourFinder;
+}
+
+TrackedBackground& HandProcessor::getTrackedBackground() {
+	return trackedBackground;
+}
+
+unsigned long long HandProcessor::getStageMicros(int stage) const {
+	return stageMicros[stage];
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "Hand.h"
+#include "HandAnalyzer.h"
+#include "HandWorkerPool.h"
+#include "TrackedBackground.h"
+#include "FingerTracker.h"
+#include "LargestBlob.h"
+
+// the hand pipeline without any camera, window or gui attached:
+// frames go in, hands with fingertips come out.
+class HandProcessor {
+public:
+	HandProcessor();
+
+	// runs every stage in order, returns true if a hand was found. captured
+	// is getMonotonicMicros() when the frame arrived, 0 means now.
+	bool update(cv::Mat frame, unsigned long long captured = 0);
+	// the same, starting from an already thresholded mask
+	bool updateThresholded(cv::Mat mask, unsigned long long captured = 0);
+	void reset();
+	
+	// for processing frames out of order: analyze() finds and analyzes the
+	// hands in a thresholded mask without following them over time, then
+	// track() gives those hands ids and follows their fingers, and has to
+	// be called in frame order
+	bool analyze(cv::Mat mask);
+	void track(vector<Hand>& hands, unsigned long long captured);
+	// threads used to analyze many hands at once, 0 means one per core
+	void setThreads(int threads);
+
+	// the individual stages, in the order update() calls them
+	void subtractBackground(cv::Mat frame);
+	bool findContours();
+	void analyzeHands();
+	void trackFingers(unsigned long long captured, float lookahead);
+
+	bool hasHand() const;
+	// the largest hand comes first
+	vector<Hand>& getHands();
+	cv::Mat& getThresholded();
+	ofxCv::ContourFinder& getContourFinder();
+	TrackedBackground& getTrackedBackground();
+	unsigned long long getStageMicros(int stage) const;
+	// smoothed seconds from capture to the end of processing
+	float getLatency() const;
+
+	HandSettings settings;
+
+protected:
+	unsigned long long startFrame(unsigned long long captured);
+	bool processThresholded(unsigned long long captured);
+	void measureLatency(unsigned long long captured);
+	void lap(int stage);
+	bool isHandArea(float area) const;
+	void selectHands(vector< pair<float, int> >& areas);
+	bool findContoursInRoi();
+	bool findLargestBlob();
+	unsigned int getTrackerId(const Hand& hand) const;
+
+	ofxCv::RunningBackground runningBackground;
+	ofxCv::ContourFinder contourFinder;
+	cv::Mat thresholded;
+	vector< pair<float, int> > areas;
+	
+	// used instead of the above when settings.tracking is on
+	TrackedBackground trackedBackground;
+	bool wasTracking;
+	ofxCv::RectTracker roiTracker;
+	cv::Mat roiMask;
+	vector< vector<cv::Point> > roiContours;
+	vector<cv::Rect> roiRects;
+	vector<int> roiIndices;
+	
+	// used when settings.largestBlob is on with a single hand
+	LargestBlob largestBlob;
+	vector<Hand> hands;
+	HandAnalyzer analyzer;
+	HandWorkerPool pool;
+	map<unsigned int, FingerTracker> fingerTrackers;
+	float latency;
+	unsigned long long stageMicros[STAGE_COUNT], lastLap;
+};
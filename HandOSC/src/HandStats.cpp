@@ -0,0 +1,168 @@
+#include "HandStats.h"
+
+string getStatName(int stat) {
+	switch(stat) {
+		case STAT_QUEUE: return "queue";
+		case STAT_OSC: return "osc";
+		case STAT_TOTAL: return "total";
+	}
+	return getStageName(stat);
+}
+
+// values below this get a bin each, above it every power of two is split
+// into this many bins
+static const int subBins = 8;
+static const int subBinBits = 3;
+// anything longer is counted in the last bin
+static const unsigned long long maxMicros = 1ULL << 32;
+
+static int getBin(unsigned long long micros) {
+	if(micros < subBins) {
+		return micros;
+	}
+	micros = MIN(micros, maxMicros - 1);
+	int exponent = 63 - __builtin_clzll(micros);
+	int sub = (micros >> (exponent - subBinBits)) & (subBins - 1);
+	return (exponent - subBinBits + 1) * subBins + sub;
+}
+
+static unsigned long long getBinUpper(int bin) {
+	if(bin < subBins) {
+		return bin;
+	}
+	int exponent = bin / subBins + subBinBits - 1;
+	int sub = bin % subBins;
+	return ((unsigned long long) (subBins + sub + 1) << (exponent - subBinBits)) - 1;
+}
+
+LatencyHistogram::LatencyHistogram() {
+	clear();
+}
+
+void LatencyHistogram::add(unsigned long long micros) {
+	__sync_fetch_and_add(&bins[getBin(micros)], 1);
+	__sync_fetch_and_add(&count, 1);
+	unsigned long long cur = max;
+	while(micros > cur) {
+		cur = __sync_val_compare_and_swap(&max, cur, micros);
+	}
+}
+
+void LatencyHistogram::clear() {
+	for(int i = 0; i < binCount; i++) {
+		bins[i] = 0;
+	}
+	count = 0;
+	max = 0;
+}
+
+unsigned int LatencyHistogram::getCount() const {
+	return count;
+}
+
+unsigned long long LatencyHistogram::getPercentile(float percentile) const {
+	unsigned int target = ceilf(percentile * count);
+	unsigned int total = 0;
+	for(int i = 0; i < binCount; i++) {
+		total += bins[i];
+		if(total >= target && total > 0) {
+			return MIN(getBinUpper(i), max);
+		}
+	}
+	return max;
+}
+
+unsigned long long LatencyHistogram::getMax() const {
+	return max;
+}
+
+StatsSummary::StatsSummary()
+:time(0)
+,fps(0)
+,frames(0)
+,dropped(0) {
+	for(int i = 0; i < STAT_COUNT; i++) {
+		p50[i] = 0;
+		p99[i] = 0;
+		max[i] = 0;
+	}
+}
+
+HandStats::HandStats()
+:published(0)
+,start(0)
+,lastUpdate(0)
+,interval(0) {
+}
+
+HandStats::~HandStats() {
+	log.close();
+}
+
+void HandStats::setup(float interval, string logPath) {
+	this->interval = interval * 1e6;
+	start = getMonotonicMicros();
+	lastUpdate = start;
+	if(!logPath.empty()) {
+		log.open(ofToDataPath(logPath).c_str());
+		log << "time,fps,frames,dropped";
+		for(int i = 0; i < STAT_COUNT; i++) {
+			string name = getStatName(i);
+			log << "," << name << " p50," << name << " p99," << name << " max";
+		}
+		log << endl;
+	}
+}
+
+void HandStats::add(const HandProcessor& processor, const FrameTimes& times) {
+	for(int i = 0; i < STAGE_COUNT; i++) {
+		histograms[i].add(processor.getStageMicros(i));
+	}
+	histograms[STAT_QUEUE].add(times.started - times.captured);
+	histograms[STAT_OSC].add(times.sent - times.processed);
+	histograms[STAT_TOTAL].add(times.sent - times.captured);
+}
+
+bool HandStats::update(unsigned int dropped) {
+	if(interval == 0) {
+		return false;
+	}
+	unsigned long long now = getMonotonicMicros();
+	if(now - lastUpdate < interval) {
+		return false;
+	}
+
+	// fill the summary nobody is reading, then make it the published one
+	StatsSummary& summary = summaries[1 - published];
+	summary.time = (now - start) / 1e6;
+	summary.frames = histograms[STAT_TOTAL].getCount();
+	summary.fps = summary.frames / ((now - lastUpdate) / 1e6);
+	summary.dropped = dropped;
+	for(int i = 0; i < STAT_COUNT; i++) {
+		LatencyHistogram& histogram = histograms[i];
+		summary.p50[i] = histogram.getPercentile(.50);
+		summary.p99[i] = histogram.getPercentile(.99);
+		summary.max[i] = histogram.getMax();
+		histogram.clear();
+	}
+	__sync_synchronize();
+	published = 1 - published;
+	lastUpdate = now;
+
+	if(log.is_open()) {
+		writeLog(summary);
+	}
+	return true;
+}
+
+const StatsSummary& HandStats::getSummary() const {
+	return summaries[published];
+}
+
+void HandStats::writeLog(const StatsSummary& summary) {
+	log << summary.time << "," << summary.fps << "," << summary.frames << "," << summary.dropped;
+	for(int i = 0; i < STAT_COUNT; i++) {
+		log << "," << summary.p50[i] << "," << summary.p99[i] << "," << summary.max[i];
+	}
+	log << endl;
+}
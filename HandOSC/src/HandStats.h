@@ -0,0 +1,91 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Hand.h"
+#include "HandProcessor.h"
+
+// everything that is measured: the processing stages, then the time a
+// frame waits before processing, the time to send it, and the whole trip
+// from capture to the end of the OSC send
+enum HandStat {
+	STAT_QUEUE = STAGE_COUNT,
+	STAT_OSC,
+	STAT_TOTAL,
+	STAT_COUNT
+};
+
+string getStatName(int stat);
+
+// timestamps for one frame, all from getMonotonicMicros()
+class FrameTimes {
+public:
+	FrameTimes()
+	:captured(0)
+	,started(0)
+	,processed(0)
+	,sent(0) {
+	}
+	unsigned long long captured, started, processed, sent;
+};
+
+// log-linear histogram of microsecond durations, 8 bins per power of two so
+// percentiles are within about 12%. adding is a couple of atomic increments,
+// so it never locks and can be shared between threads.
+class LatencyHistogram {
+public:
+	LatencyHistogram();
+
+	void add(unsigned long long micros);
+	void clear();
+
+	unsigned int getCount() const;
+	// the upper edge of the bin holding this percentile, between 0 and 1
+	unsigned long long getPercentile(float percentile) const;
+	unsigned long long getMax() const;
+
+	static const int binCount = 240;
+
+protected:
+	volatile unsigned int bins[binCount];
+	volatile unsigned int count;
+	volatile unsigned long long max;
+};
+
+// the stats for one export period
+class StatsSummary {
+public:
+	StatsSummary();
+
+	// seconds since setup() at the end of the period
+	float time;
+	float fps;
+	unsigned int frames, dropped;
+	unsigned long long p50[STAT_COUNT], p99[STAT_COUNT], max[STAT_COUNT];
+};
+
+// collects one histogram per stage. add() and update() are called from the
+// thread that processes frames; at every interval update() summarizes and
+// clears the histograms, appends a line to the csv log, and publishes the
+// summary so it can be read from any thread with getSummary().
+class HandStats {
+public:
+	HandStats();
+	~HandStats();
+
+	// an interval of 0 never exports, an empty logPath never writes a log
+	void setup(float interval = 1, string logPath = "");
+	void add(const HandProcessor& processor, const FrameTimes& times);
+	// dropped is the total number of frames dropped so far. returns true
+	// when a new summary is ready.
+	bool update(unsigned int dropped = 0);
+	const StatsSummary& getSummary() const;
+
+protected:
+	void writeLog(const StatsSummary& summary);
+
+	LatencyHistogram histograms[STAT_COUNT];
+	StatsSummary summaries[2];
+	volatile int published;
+	unsigned long long start, lastUpdate, interval;
+	ofstream log;
+};
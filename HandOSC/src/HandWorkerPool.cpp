@@ -0,0 +1,90 @@
+#include "HandWorkerPool.h"
+#include "Poco/Environment.h"
+
+void HandWorker::start(vector<Hand>& hands, int first, int step, const HandSettings& settings, int height) {
+	this->hands = &hands;
+	this->first = first;
+	this->step = step;
+	this->settings = &settings;
+	this->height = height;
+	ready.set();
+}
+
+void HandWorker::wait() {
+	finished.wait();
+}
+
+void HandWorker::stop() {
+	stopThread();
+	ready.set();
+	waitForThread(false);
+}
+
+void HandWorker::threadedFunction() {
+	while(true) {
+		ready.wait();
+		if(!isThreadRunning()) {
+			break;
+		}
+		analyzer.resetStageMicros();
+		for(int i = first; i < hands->size(); i += step) {
+			analyzer.analyze((*hands)[i], *settings, height);
+		}
+		finished.set();
+	}
+}
+
+HandWorkerPool::HandWorkerPool()
+:active(0)
+,ready(false) {
+}
+
+HandWorkerPool::~HandWorkerPool() {
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->stop();
+		delete workers[i];
+	}
+}
+
+void HandWorkerPool::setup(int threads) {
+	if(threads < 1) {
+		threads = Poco::Environment::processorCount();
+	}
+	for(int i = workers.size() + 1; i < threads; i++) {
+		HandWorker* worker = new HandWorker();
+		worker->startThread(true, false);
+		workers.push_back(worker);
+	}
+	ready = true;
+}
+
+bool HandWorkerPool::isSetup() const {
+	return ready;
+}
+
+void HandWorkerPool::analyze(vector<Hand>& hands, const HandSettings& settings, int height) {
+	int step = size();
+	active = MAX(MIN((int) hands.size(), step) - 1, 0);
+	for(int i = 0; i < active; i++) {
+		workers[i]->start(hands, i + 1, step, settings, height);
+	}
+	analyzer.resetStageMicros();
+	for(int i = 0; i < hands.size(); i += step) {
+		analyzer.analyze(hands[i], settings, height);
+	}
+	for(int i = 0; i < active; i++) {
+		workers[i]->wait();
+	}
+}
+
+int HandWorkerPool::size() const {
+	return workers.size() + 1;
+}
+
+unsigned long long HandWorkerPool::getStageMicros(int stage) const {
+	unsigned long long micros = analyzer.getStageMicros(stage);
+	for(int i = 0; i < active; i++) {
+		micros = MAX(micros, workers[i]->analyzer.getStageMicros(stage));
+	}
+	return micros;
+}
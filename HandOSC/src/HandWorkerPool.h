@@ -0,0 +1,46 @@
+#pragma once
+
+#include "HandAnalyzer.h"
+#include "Poco/Event.h"
+
+// one thread with its own analyzer, woken up once per frame to analyze
+// every step-th hand starting at first
+class HandWorker : public ofThread {
+public:
+	void start(vector<Hand>& hands, int first, int step, const HandSettings& settings, int height);
+	void wait();
+	void stop();
+	
+	HandAnalyzer analyzer;
+	
+protected:
+	void threadedFunction();
+	
+	Poco::Event ready, finished;
+	vector<Hand>* hands;
+	const HandSettings* settings;
+	int first, step, height;
+};
+
+// spreads the per-hand stages of a frame across all cores. the calling
+// thread takes the first share, so a frame with as many hands as cores
+// costs about the same as a frame with one hand.
+class HandWorkerPool {
+public:
+	HandWorkerPool();
+	~HandWorkerPool();
+	
+	// threads includes the calling thread, 0 means one per core
+	void setup(int threads = 0);
+	bool isSetup() const;
+	void analyze(vector<Hand>& hands, const HandSettings& settings, int height);
+	int size() const;
+	// the slowest time for each stage across all hands in the last frame
+	unsigned long long getStageMicros(int stage) const;
+	
+protected:
+	HandAnalyzer analyzer;
+	vector<HandWorker*> workers;
+	int active;
+	bool ready;
+};
@@ -0,0 +1,69 @@
+#include "HullDetector.h"
+
+using namespace cv;
+
+HullDetector::HullDetector()
+:maxValleyAngle(100) {
+}
+
+void HullDetector::find(const ofPolyline& contour, float minDepth, float mergeDistance, vector<int>& tips, vector<int>& valleys) {
+	tips.clear();
+	valleys.clear();
+	int n = contour.size();
+	if(n < 4) {
+		return;
+	}
+	points.resize(n);
+	for(int i = 0; i < n; i++) {
+		points[i] = cv::Point(contour[i].x, contour[i].y);
+	}
+	convexHull(points, hull, false, false);
+	if(hull.size() < 3) {
+		return;
+	}
+	convexityDefects(points, hull, defects);
+	
+	float minCos = cosf(ofDegToRad(maxValleyAngle));
+	for(int i = 0; i < defects.size(); i++) {
+		const Vec4i& defect = defects[i];
+		// depth is fixed point with 8 fractional bits
+		if(defect[3] < minDepth * 256) {
+			continue;
+		}
+		const cv::Point& start = points[defect[0]];
+		const cv::Point& end = points[defect[1]];
+		const cv::Point& valley = points[defect[2]];
+		float ax = start.x - valley.x, ay = start.y - valley.y;
+		float bx = end.x - valley.x, by = end.y - valley.y;
+		float lengths = sqrtf((ax * ax + ay * ay) * (bx * bx + by * by));
+		if(lengths == 0 || (ax * bx + ay * by) < minCos * lengths) {
+			continue;
+		}
+		valleys.push_back(defect[2]);
+		tips.push_back(defect[0]);
+		tips.push_back(defect[1]);
+	}
+	
+	// neighboring valleys share a fingertip, and a rounded fingertip can
+	// have a few hull points
+	ofSort(tips);
+	float mergeSquared = mergeDistance * mergeDistance;
+	int kept = 0;
+	for(int i = 0; i < tips.size(); i++) {
+		if(kept > 0) {
+			const cv::Point& a = points[tips[kept - 1]], &b = points[tips[i]];
+			if((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) < mergeSquared) {
+				continue;
+			}
+		}
+		tips[kept++] = tips[i];
+	}
+	// the contour is closed, so the last tip can be next to the first
+	if(kept > 1) {
+		const cv::Point& a = points[tips[kept - 1]], &b = points[tips[0]];
+		if((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) < mergeSquared) {
+			kept--;
+		}
+	}
+	tips.resize(kept);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// finds fingertips on the raw contour without resampling or smoothing.
+// the gaps between fingers are the convexity defects of the contour: deep
+// dents that are narrower than maxValleyAngle. the hull points on either
+// side of each of those valleys are the fingertips. a convex hull and its
+// defects cost O(n log n) with no trig, and the only parameter that
+// matters is how deep a valley has to be.
+class HullDetector {
+public:
+	HullDetector();
+	
+	// tips and valleys are indices into contour, tips in contour order.
+	// tips closer together than mergeDistance count as one.
+	void find(const ofPolyline& contour, float minDepth, float mergeDistance, vector<int>& tips, vector<int>& valleys);
+	
+	// in degrees, wider dents are the sides of the hand rather than fingers
+	float maxValleyAngle;
+	
+protected:
+	vector<cv::Point> points;
+	vector<int> hull;
+	vector<cv::Vec4i> defects;
+};
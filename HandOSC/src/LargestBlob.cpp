@@ -0,0 +1,189 @@
+#include "LargestBlob.h"
+
+using namespace cv;
+
+bool LargestBlob::find(const Mat& mask, Rect roi, float minArea, float maxArea) {
+	found = -1;
+	encodeRuns(mask, roi);
+	measureComponents();
+	// components are traced from the largest bound down until no bound is
+	// larger than the best traced area, so the pick matches ContourFinder's
+	float bestArea = 0;
+	for(int i = 0; i < order.size(); i++) {
+		float maxTracedArea = -order[i].first;
+		if(maxTracedArea < minArea || (found >= 0 && maxTracedArea <= bestArea)) {
+			break;
+		}
+		float area;
+		if(trace(order[i].second, area) && area >= minArea && area <= maxArea && (found < 0 || area > bestArea)) {
+			found = order[i].second;
+			bestArea = area;
+			contour.swap(contours[0]);
+		}
+	}
+	return found >= 0;
+}
+
+// splits every row into runs of foreground pixels, labeling each run after
+// the runs it touches in the row above
+void LargestBlob::encodeRuns(const Mat& mask, Rect roi) {
+	runs.clear();
+	parents.clear();
+	int left = roi.x + 1, right = roi.x + roi.width - 1;
+	int top = roi.y + 1, bottom = roi.y + roi.height - 1;
+	int prevBegin = 0, prevEnd = 0;
+	for(int y = top; y < bottom; y++) {
+		const unsigned char* row = mask.ptr<unsigned char>(y);
+		int rowBegin = runs.size();
+		int prev = prevBegin;
+		int x = left;
+		while(x < right) {
+			// background is skipped a word at a time
+			while(x + 8 <= right) {
+				uint64_t word;
+				memcpy(&word, row + x, sizeof(word));
+				if(word != 0) {
+					break;
+				}
+				x += 8;
+			}
+			while(x < right && row[x] == 0) {
+				x++;
+			}
+			if(x == right) {
+				break;
+			}
+			Run run;
+			run.y = y;
+			run.start = x;
+			while(x < right && row[x] != 0) {
+				x++;
+			}
+			run.end = x - 1;
+			run.label = -1;
+
+			// runs touch if they overlap or meet diagonally. the last run
+			// above that touches this one may also touch the next one.
+			while(prev < prevEnd && runs[prev].end < run.start - 1) {
+				prev++;
+			}
+			for(int i = prev; i < prevEnd && runs[i].start <= run.end + 1; i++) {
+				if(run.label < 0) {
+					run.label = runs[i].label;
+				} else {
+					join(run.label, runs[i].label);
+				}
+			}
+			if(run.label < 0) {
+				run.label = parents.size();
+				parents.push_back(run.label);
+			}
+			runs.push_back(run);
+		}
+		prevBegin = rowBegin;
+		prevEnd = runs.size();
+	}
+}
+
+int LargestBlob::getRoot(int label) {
+	int root = label;
+	while(parents[root] != root) {
+		root = parents[root];
+	}
+	while(parents[label] != root) {
+		int next = parents[label];
+		parents[label] = root;
+		label = next;
+	}
+	return root;
+}
+
+void LargestBlob::join(int a, int b) {
+	a = getRoot(a);
+	b = getRoot(b);
+	if(a < b) {
+		parents[b] = a;
+	} else if(b < a) {
+		parents[a] = b;
+	}
+}
+
+// sums the area, centroid and bounds of every component, then orders them
+// by the largest area their traced contour could have: the box through
+// their outer pixels, which also holds for contours around holes
+void LargestBlob::measureComponents() {
+	components.resize(parents.size());
+	for(int i = 0; i < components.size(); i++) {
+		components[i].area = 0;
+	}
+	for(int i = 0; i < runs.size(); i++) {
+		Run& run = runs[i];
+		run.label = getRoot(run.label);
+		Component& component = components[run.label];
+		int length = run.end - run.start + 1;
+		if(component.area == 0) {
+			component.sumX = 0;
+			component.sumY = 0;
+			component.left = run.start;
+			component.right = run.end;
+			component.top = run.y;
+		}
+		component.area += length;
+		component.sumX += (run.start + run.end) * .5 * length;
+		component.sumY += (double) run.y * length;
+		component.left = MIN(component.left, run.start);
+		component.right = MAX(component.right, run.end);
+		component.bottom = run.y;
+	}
+	order.clear();
+	for(int i = 0; i < components.size(); i++) {
+		const Component& component = components[i];
+		if(component.area > 0) {
+			int maxTracedArea = (component.right - component.left) * (component.bottom - component.top);
+			order.push_back(pair<int, int>(-maxTracedArea, i));
+		}
+	}
+	ofSort(order);
+}
+
+// draws one component into a mask just big enough to hold it with a blank
+// border, and traces that
+bool LargestBlob::trace(int label, float& area) {
+	const Component& component = components[label];
+	Rect bounds(component.left - 1, component.top - 1,
+		component.right - component.left + 3, component.bottom - component.top + 3);
+	blobMask.create(bounds.height, bounds.width, CV_8UC1);
+	blobMask.setTo(Scalar(0));
+	for(int i = 0; i < runs.size(); i++) {
+		const Run& run = runs[i];
+		if(run.label == label) {
+			unsigned char* row = blobMask.ptr<unsigned char>(run.y - bounds.y);
+			memset(row + run.start - bounds.x, 255, run.end - run.start + 1);
+		}
+	}
+	cv::findContours(blobMask, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE, bounds.tl());
+	if(contours.empty()) {
+		return false;
+	}
+	area = contourArea(contours[0]);
+	return true;
+}
+
+const vector<cv::Point>& LargestBlob::getContour() const {
+	return contour;
+}
+
+Rect LargestBlob::getBounds() const {
+	const Component& component = components[found];
+	return Rect(component.left, component.top,
+		component.right - component.left + 1, component.bottom - component.top + 1);
+}
+
+int LargestBlob::getPixelArea() const {
+	return components[found].area;
+}
+
+ofVec2f LargestBlob::getPixelCentroid() const {
+	const Component& component = components[found];
+	return ofVec2f(component.sumX / component.area, component.sumY / component.area);
+}
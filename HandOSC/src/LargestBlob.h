@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// finds the largest blob in a mask without tracing every contour. one pass
+// run-length encodes the mask and joins overlapping runs into 8-connected
+// components while summing their area, centroid and bounds. components are
+// then drawn into a small mask and traced one at a time, largest bounds
+// first, only until none left could have a larger contour area.
+//
+// like cv::findContours, the outermost pixels of the region are ignored so
+// the traced contour is the same one ContourFinder would return. blobs
+// inside the hole of another blob count as separate blobs here, while
+// ContourFinder only sees the outer one.
+class LargestBlob {
+public:
+	// looks inside roi for the blob with the largest traced area between
+	// minArea and maxArea, returns false if there is none
+	bool find(const cv::Mat& mask, cv::Rect roi, float minArea, float maxArea);
+
+	// the traced outline in mask coordinates
+	const vector<cv::Point>& getContour() const;
+	cv::Rect getBounds() const;
+	// from the run-length pass: the number of pixels and their centroid
+	int getPixelArea() const;
+	ofVec2f getPixelCentroid() const;
+
+protected:
+	class Run {
+	public:
+		int y, start, end, label;
+	};
+	class Component {
+	public:
+		int area;
+		double sumX, sumY;
+		int left, top, right, bottom;
+	};
+
+	void encodeRuns(const cv::Mat& mask, cv::Rect roi);
+	int getRoot(int label);
+	void join(int a, int b);
+	void measureComponents();
+	// area is the contourArea of the traced outline
+	bool trace(int label, float& area);
+
+	vector<Run> runs;
+	vector<int> parents;
+	vector<Component> components;
+	vector< pair<int, int> > order;
+	cv::Mat blobMask;
+	vector< vector<cv::Point> > contours;
+	vector<cv::Point> contour;
+	int found;
+};
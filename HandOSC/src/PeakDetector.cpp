@@ -0,0 +1,66 @@
+#include "PeakDetector.h"
+
+int PeakDetector::find(const float* values, int n, float cutoff, int peakArea, int* peaks, int maxPeaks) {
+	int found = 0;
+	if(n == 0 || maxPeaks == 0) {
+		return found;
+	}
+	int radius = MAX(peakArea - 1, 0);
+	
+	// the window covers the whole contour, so only the first maximum survives
+	if(2 * radius + 1 >= n) {
+		int best = 0;
+		for(int i = 1; i < n; i++) {
+			if(values[i] > values[best]) {
+				best = i;
+			}
+		}
+		if(values[best] > cutoff) {
+			peaks[found++] = best;
+		}
+		return found;
+	}
+	
+	// positions run from -radius to n - 1 + radius, and wrap when indexing values
+	int capacity = 2 * radius + 2;
+	window.resize(capacity);
+	int head = 0, tail = 0;
+	for(int position = -radius; position < n + radius; position++) {
+		float cur = values[(position + n) % n];
+		while(tail > head && values[(window[(tail - 1) % capacity] + n) % n] < cur) {
+			tail--;
+		}
+		window[tail++ % capacity] = position;
+		
+		int center = position - radius;
+		if(center < 0) {
+			continue;
+		}
+		while(window[head % capacity] < center - radius) {
+			head++;
+		}
+		if(window[head % capacity] == center && values[center] > cutoff) {
+			peaks[found++] = center;
+			if(found == maxPeaks) {
+				break;
+			}
+		}
+	}
+	return found;
+}
+
+void PeakDetector::find(const vector<float>& values, float cutoff, int peakArea, vector<int>& peaks) {
+	int n = values.size();
+	peaks.resize(n);
+	if(n == 0) {
+		return;
+	}
+	peaks.resize(find(&values[0], n, cutoff, peakArea, &peaks[0], n));
+}
+
+void PeakDetector::find(const vector< vector<float> >& values, float cutoff, int peakArea, vector< vector<int> >& peaks) {
+	peaks.resize(values.size());
+	for(int i = 0; i < values.size(); i++) {
+		find(values[i], cutoff, peakArea, peaks[i]);
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ofMain.h"
+
+// linear time replacement for findPeaks. a value is a peak when it's above
+// the cutoff and it's the largest value within peakArea - 1 samples on
+// either side, wrapping around the closed contour. ties go to the earlier
+// sample. runs a sliding window maximum over the contour with a monotonic
+// deque, so there's no sorting and no comparison between candidates.
+class PeakDetector {
+public:
+	// writes up to maxPeaks indices into peaks in contour order, returns the count
+	int find(const float* values, int n, float cutoff, int peakArea, int* peaks, int maxPeaks);
+	// resizes peaks to the number found, reusing its capacity
+	void find(const vector<float>& values, float cutoff, int peakArea, vector<int>& peaks);
+	// one pass per contour, with peaks[i] filled from values[i]
+	void find(const vector< vector<float> >& values, float cutoff, int peakArea, vector< vector<int> >& peaks);
+
+protected:
+	// ring buffer of positions with decreasing values
+	vector<int> window;
+};
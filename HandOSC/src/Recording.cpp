@@ -0,0 +1,390 @@
+#include "Recording.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace cv;
+
+static const char recordingMagic[4] = {'H', 'R', 'E', 'C'};
+static const char chunkMagic[4] = {'C', 'H', 'N', 'K'};
+static const uint32_t recordingVersion = 3;
+static const uint16_t maxRun = 0xffff;
+
+void encodeMaskRuns(const Mat& mask, vector<uint16_t>& runs) {
+	runs.clear();
+	bool foreground = false;
+	uint16_t run = 0;
+	for(int y = 0; y < mask.rows; y++) {
+		const unsigned char* row = mask.ptr<unsigned char>(y);
+		for(int x = 0; x < mask.cols; x++) {
+			if((row[x] != 0) != foreground || run == maxRun) {
+				runs.push_back(run);
+				run = 0;
+				foreground = !foreground;
+				// a run too long for 16 bits continues after an empty one
+				if((row[x] != 0) != foreground) {
+					runs.push_back(0);
+					foreground = !foreground;
+				}
+			}
+			run++;
+		}
+	}
+	runs.push_back(run);
+}
+
+void decodeMaskRuns(const uint16_t* runs, int count, Mat& mask) {
+	unsigned char* pixel = mask.ptr<unsigned char>(0);
+	unsigned char* end = pixel + mask.total();
+	for(int i = 0; i < count && pixel < end; i++) {
+		int run = MIN(runs[i], end - pixel);
+		memset(pixel, i % 2 ? 255 : 0, run);
+		pixel += run;
+	}
+	memset(pixel, 0, end - pixel);
+}
+
+static void append(vector<unsigned char>& buffer, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*) data;
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+static void applyFlags(uint32_t flags, HandSettings& settings) {
+	settings.multiHand = flags & RECORDING_MULTI_HAND;
+	settings.tracking = flags & RECORDING_TRACKING;
+	settings.largestBlob = flags & RECORDING_LARGEST_BLOB;
+	settings.hullFingers = flags & RECORDING_HULL_FINGERS;
+}
+
+static uint32_t getFlags(const HandSettings& settings) {
+	return (settings.multiHand ? RECORDING_MULTI_HAND : 0) |
+		(settings.tracking ? RECORDING_TRACKING : 0) |
+		(settings.largestBlob ? RECORDING_LARGEST_BLOB : 0) |
+		(settings.hullFingers ? RECORDING_HULL_FINGERS : 0);
+}
+
+RecordingWriter::RecordingWriter()
+:file(NULL)
+,chunkFrames(32) {
+}
+
+RecordingWriter::~RecordingWriter() {
+	close();
+}
+
+bool RecordingWriter::open(string path, int width, int height, RecordingContent content, bool compressed, int chunkFrames) {
+	close();
+	ofScopedLock lock(mutex);
+	file = fopen(ofToDataPath(path).c_str(), "wb");
+	if(file == NULL) {
+		ofLogError() << "couldn't create recording " << path;
+		return false;
+	}
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, recordingMagic, sizeof(header.magic));
+	header.version = recordingVersion;
+	header.width = width;
+	header.height = height;
+	header.content = content;
+	header.compressed = compressed && content == RECORDING_MASK;
+	fwrite(&header, sizeof(header), 1, file);
+	this->chunkFrames = chunkFrames;
+	chunk.clear();
+	frameOffsets.clear();
+	index.clear();
+	return true;
+}
+
+void RecordingWriter::close() {
+	ofScopedLock lock(mutex);
+	if(file == NULL) {
+		return;
+	}
+	writeChunk();
+	header.indexOffset = ftell(file);
+	header.chunkCount = index.size();
+	if(!index.empty()) {
+		fwrite(&index[0], sizeof(RecordingIndexEntry), index.size(), file);
+	}
+	fseek(file, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, file);
+	fclose(file);
+	file = NULL;
+}
+
+bool RecordingWriter::isOpen() {
+	ofScopedLock lock(mutex);
+	return file != NULL;
+}
+
+bool RecordingWriter::update(HandProcessor& processor, Mat frame, unsigned long long captured, unsigned int sequence) {
+	bool recording, recordGray, starting;
+	{
+		ofScopedLock lock(mutex);
+		recording = file != NULL;
+		recordGray = recording && header.content == RECORDING_GRAY;
+		starting = recording && header.frameCount == 0;
+	}
+	if(!recording) {
+		return processor.update(frame, captured);
+	}
+	if(starting) {
+		processor.reset();
+	}
+	
+	bool found;
+	if(recordGray) {
+		if(frame.channels() == 3) {
+			cvtColor(frame, gray, CV_RGB2GRAY);
+		} else {
+			gray = frame;
+		}
+		found = processor.update(gray, captured);
+	} else {
+		found = processor.update(frame, captured);
+	}
+	vector<Hand>& hands = processor.getHands();
+	add(recordGray ? gray : processor.getThresholded(), processor.settings,
+		hands.empty() ? NULL : &hands[0].contour, captured, sequence);
+	return found;
+}
+
+void RecordingWriter::add(const Mat& image, const HandSettings& settings, const ofPolyline* contour, unsigned long long captured, unsigned int sequence) {
+	ofScopedLock lock(mutex);
+	if(file == NULL) {
+		return;
+	}
+	if(image.cols != header.width || image.rows != header.height || image.type() != CV_8UC1) {
+		ofLogWarning() << "frame " << sequence << " doesn't match the recording, skipping it";
+		return;
+	}
+
+	RecordingFrame frame;
+	frame.captured = captured;
+	frame.sequence = sequence;
+	frame.flags = getFlags(settings);
+	frame.threshold = settings.threshold;
+	frame.smoothing = settings.smoothing;
+	frame.sampleOffset = settings.sampleOffset;
+	frame.peakAngleCutoff = settings.peakAngleCutoff;
+	frame.peakNeighborDistance = settings.peakNeighborDistance;
+	frame.minDefectDepth = settings.minDefectDepth;
+	frame.minHandArea = settings.minHandArea;
+	frame.predictionLatency = settings.predictionLatency;
+	frame.contourSize = contour == NULL ? 0 : contour->size();
+
+	const void* imageData = image.data;
+	uint32_t imageBytes = image.total();
+	Mat continuous;
+	if(header.compressed) {
+		encodeMaskRuns(image, runs);
+		imageData = &runs[0];
+		imageBytes = runs.size() * sizeof(uint16_t);
+	} else if(!image.isContinuous()) {
+		continuous = image.clone();
+		imageData = continuous.data;
+	}
+	frame.imageSize = (imageBytes + 3) & ~3;
+
+	frameOffsets.push_back(chunk.size());
+	append(chunk, &frame, sizeof(frame));
+	append(chunk, imageData, imageBytes);
+	chunk.resize(chunk.size() + frame.imageSize - imageBytes, 0);
+	for(int i = 0; i < frame.contourSize; i++) {
+		const ofPoint& point = (*contour)[i];
+		int16_t xy[2] = {(int16_t) point.x, (int16_t) point.y};
+		append(chunk, xy, sizeof(xy));
+	}
+	header.frameCount++;
+	if(frameOffsets.size() == chunkFrames) {
+		writeChunk();
+	}
+}
+
+// writes the buffered frames and flushes them, so a crash only loses the
+// current chunk
+void RecordingWriter::writeChunk() {
+	if(frameOffsets.empty()) {
+		return;
+	}
+	RecordingChunk header;
+	memcpy(header.magic, chunkMagic, sizeof(header.magic));
+	header.frameCount = frameOffsets.size();
+	uint32_t tableSize = frameOffsets.size() * sizeof(uint32_t);
+	header.size = tableSize + chunk.size();
+
+	RecordingIndexEntry entry;
+	entry.offset = ftell(file);
+	entry.firstFrame = this->header.frameCount - frameOffsets.size();
+	entry.frameCount = frameOffsets.size();
+	index.push_back(entry);
+
+	// offsets were from the first frame, make them from the chunk header
+	for(int i = 0; i < frameOffsets.size(); i++) {
+		frameOffsets[i] += sizeof(RecordingChunk) + tableSize;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(&frameOffsets[0], sizeof(uint32_t), frameOffsets.size(), file);
+	fwrite(&chunk[0], 1, chunk.size(), file);
+	fflush(file);
+	chunk.clear();
+	frameOffsets.clear();
+}
+
+RecordingReader::RecordingReader()
+:data(NULL)
+,length(0)
+,header(NULL) {
+}
+
+RecordingReader::~RecordingReader() {
+	close();
+}
+
+bool RecordingReader::open(string path) {
+	close();
+	int fd = ::open(ofToDataPath(path).c_str(), O_RDONLY);
+	if(fd < 0) {
+		ofLogError() << "couldn't open recording " << path;
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) < 0 || info.st_size < (off_t) sizeof(RecordingHeader)) {
+		ofLogError() << path << " is too short to be a recording";
+		::close(fd);
+		return false;
+	}
+	// private and writable, so the pipeline can't change the file through
+	// frames that point into it
+	void* memory = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		ofLogError() << "couldn't map recording " << path;
+		return false;
+	}
+	data = (unsigned char*) memory;
+	length = info.st_size;
+	header = (const RecordingHeader*) data;
+	if(memcmp(header->magic, recordingMagic, sizeof(header->magic)) != 0 || header->version != recordingVersion) {
+		ofLogError() << path << " is not a recording";
+		close();
+		return false;
+	}
+
+	if(header->indexOffset != 0 && header->indexOffset <= length &&
+		header->indexOffset + (uint64_t) header->chunkCount * sizeof(RecordingIndexEntry) <= length) {
+		const RecordingIndexEntry* index = (const RecordingIndexEntry*) (data + header->indexOffset);
+		for(int i = 0; i < header->chunkCount; i++) {
+			if(!readChunk(index[i].offset)) {
+				ofLogWarning() << path << " is damaged, reading the first " << frameOffsets.size() << " frames";
+				break;
+			}
+		}
+	} else {
+		ofLogWarning() << path << " wasn't closed, reading the chunks without the index";
+		uint64_t offset = sizeof(RecordingHeader);
+		while(readChunk(offset)) {
+			offset += sizeof(RecordingChunk) + ((const RecordingChunk*) (data + offset))->size;
+		}
+	}
+	return true;
+}
+
+// adds the frames of the chunk at offset, stopping at the first frame that
+// doesn't fit inside the chunk, since a file that was never closed can end
+// anywhere
+bool RecordingReader::readChunk(uint64_t offset) {
+	if(offset + sizeof(RecordingChunk) > length) {
+		return false;
+	}
+	const RecordingChunk* chunk = (const RecordingChunk*) (data + offset);
+	uint64_t tableSize = (uint64_t) chunk->frameCount * sizeof(uint32_t);
+	uint64_t end = sizeof(RecordingChunk) + chunk->size;
+	if(memcmp(chunk->magic, chunkMagic, sizeof(chunk->magic)) != 0 ||
+		chunk->size > length || offset + end > length || tableSize > chunk->size) {
+		return false;
+	}
+	uint64_t imageBytes = ((uint64_t) header->width * header->height + 3) & ~3;
+	const uint32_t* table = (const uint32_t*) (chunk + 1);
+	for(int i = 0; i < chunk->frameCount; i++) {
+		uint64_t frameOffset = table[i];
+		if(frameOffset < sizeof(RecordingChunk) + tableSize || frameOffset + sizeof(RecordingFrame) > end) {
+			return false;
+		}
+		const RecordingFrame* frame = (const RecordingFrame*) (data + offset + frameOffset);
+		if(!header->compressed && frame->imageSize != imageBytes) {
+			return false;
+		}
+		uint64_t frameEnd = frameOffset + sizeof(RecordingFrame) + frame->imageSize +
+			(uint64_t) frame->contourSize * 2 * sizeof(int16_t);
+		if(frameEnd > end) {
+			return false;
+		}
+		frameOffsets.push_back(offset + frameOffset);
+	}
+	return true;
+}
+
+void RecordingReader::close() {
+	if(data != NULL) {
+		munmap(data, length);
+	}
+	data = NULL;
+	length = 0;
+	header = NULL;
+	frameOffsets.clear();
+}
+
+int RecordingReader::size() const {
+	return frameOffsets.size();
+}
+
+int RecordingReader::getWidth() const {
+	return header->width;
+}
+
+int RecordingReader::getHeight() const {
+	return header->height;
+}
+
+RecordingContent RecordingReader::getContent() const {
+	return (RecordingContent) header->content;
+}
+
+bool RecordingReader::read(int i, RecordedFrame& frame) {
+	if(i < 0 || i >= frameOffsets.size()) {
+		return false;
+	}
+	unsigned char* cur = data + frameOffsets[i];
+	// readChunk() checked that the whole frame is inside its chunk
+	const RecordingFrame* recorded = (const RecordingFrame*) cur;
+	cur += sizeof(RecordingFrame);
+	unsigned char* contour = cur + recorded->imageSize;
+
+	frame.captured = recorded->captured;
+	frame.sequence = recorded->sequence;
+	frame.settings.threshold = recorded->threshold;
+	frame.settings.smoothing = recorded->smoothing;
+	frame.settings.sampleOffset = recorded->sampleOffset;
+	frame.settings.peakAngleCutoff = recorded->peakAngleCutoff;
+	frame.settings.peakNeighborDistance = recorded->peakNeighborDistance;
+	frame.settings.minDefectDepth = recorded->minDefectDepth;
+	frame.settings.minHandArea = recorded->minHandArea;
+	frame.settings.predictionLatency = recorded->predictionLatency;
+	applyFlags(recorded->flags, frame.settings);
+
+	if(header->compressed) {
+		frame.image.create(header->height, header->width, CV_8UC1);
+		decodeMaskRuns((const uint16_t*) cur, recorded->imageSize / sizeof(uint16_t), frame.image);
+	} else {
+		frame.image = Mat(header->height, header->width, CV_8UC1, cur);
+	}
+
+	const int16_t* points = (const int16_t*) contour;
+	frame.contour.resize(recorded->contourSize);
+	for(int j = 0; j < recorded->contourSize; j++) {
+		frame.contour[j] = cv::Point(points[2 * j], points[2 * j + 1]);
+	}
+	return true;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+#include "Hand.h"
+#include "HandProcessor.h"
+
+// a recording is everything HandOSC saw, so a session can be replayed
+// through the pipeline exactly. the file is:
+//
+//	RecordingHeader
+//	chunks of up to chunkFrames frames, each a RecordingChunk followed by
+//	the offset of every frame from the start of the chunk, then the frames
+//	the index, one RecordingIndexEntry per chunk
+//
+// every frame is a RecordingFrame, then the image (raw, or run-length
+// encoded as alternating background and foreground run lengths), then the
+// chosen contour as x, y pairs. the index is written on close; a recording
+// that was never closed is read by walking the chunks instead.
+
+enum RecordingContent {
+	// the grayscale camera frame, replayed through background subtraction
+	RECORDING_GRAY = 0,
+	// the thresholded mask, replayed from contour finding on
+	RECORDING_MASK
+};
+
+enum RecordingFlags {
+	RECORDING_MULTI_HAND = 1,
+	RECORDING_TRACKING = 2,
+	RECORDING_LARGEST_BLOB = 4,
+	RECORDING_HULL_FINGERS = 8
+};
+
+struct RecordingHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width, height;
+	uint32_t content;
+	uint32_t compressed;
+	uint32_t frameCount;
+	uint32_t chunkCount;
+	uint64_t indexOffset;
+};
+
+struct RecordingChunk {
+	char magic[4];
+	uint32_t frameCount;
+	// bytes after this header
+	uint64_t size;
+};
+
+struct RecordingIndexEntry {
+	uint64_t offset;
+	uint32_t firstFrame;
+	uint32_t frameCount;
+};
+
+struct RecordingFrame {
+	uint64_t captured;
+	uint32_t sequence;
+	uint32_t flags;
+	float threshold, smoothing, sampleOffset, peakAngleCutoff, peakNeighborDistance;
+	float minDefectDepth, minHandArea, predictionLatency;
+	// bytes of image data, padded to 4 bytes
+	uint32_t imageSize;
+	uint32_t contourSize;
+};
+
+// one frame read back from a recording
+class RecordedFrame {
+public:
+	unsigned long long captured;
+	unsigned int sequence;
+	// the sliders and mode toggles at the time, everything else is default
+	HandSettings settings;
+	// points straight into the file unless it was compressed
+	cv::Mat image;
+	vector<cv::Point> contour;
+};
+
+// appends frames to a recording. every method locks, so recording can be
+// started and stopped from one thread while another adds frames.
+class RecordingWriter {
+public:
+	RecordingWriter();
+	~RecordingWriter();
+
+	// compressed only applies to masks
+	bool open(string path, int width, int height, RecordingContent content, bool compressed = false, int chunkFrames = 32);
+	void close();
+	bool isOpen();
+
+	// runs frame through processor and records it while the writer is
+	// open. gray recordings process the gray frame they record, so a replay
+	// sees exactly the same input, and the background is reset when a
+	// recording starts so the replay starts from the same state.
+	bool update(HandProcessor& processor, cv::Mat frame, unsigned long long captured, unsigned int sequence);
+	// does nothing unless the writer is open. contour is the chosen hand's,
+	// or NULL when there was none.
+	void add(const cv::Mat& image, const HandSettings& settings, const ofPolyline* contour, unsigned long long captured, unsigned int sequence);
+
+protected:
+	void writeChunk();
+
+	ofMutex mutex;
+	FILE* file;
+	RecordingHeader header;
+	int chunkFrames;
+	vector<unsigned char> chunk;
+	vector<uint32_t> frameOffsets;
+	vector<RecordingIndexEntry> index;
+	vector<uint16_t> runs;
+	cv::Mat gray;
+};
+
+// memory maps a recording and decodes frames from it
+class RecordingReader {
+public:
+	RecordingReader();
+	~RecordingReader();
+
+	bool open(string path);
+	void close();
+
+	int size() const;
+	int getWidth() const;
+	int getHeight() const;
+	RecordingContent getContent() const;
+	bool read(int i, RecordedFrame& frame);
+
+protected:
+	bool readChunk(uint64_t offset);
+
+	unsigned char* data;
+	size_t length;
+	const RecordingHeader* header;
+	vector<uint64_t> frameOffsets;
+};
+
+// writes mask as run lengths, starting with a background run
+void encodeMaskRuns(const cv::Mat& mask, vector<uint16_t>& runs);
+void decodeMaskRuns(const uint16_t* runs, int count, cv::Mat& mask);
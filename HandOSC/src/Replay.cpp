@@ -0,0 +1,73 @@
+#include "Replay.h"
+#include "ofxXmlSettings.h"
+
+static bool isSameContour(const ofPolyline& contour, const vector<cv::Point>& recorded) {
+	if(contour.size() != recorded.size()) {
+		return false;
+	}
+	for(int i = 0; i < recorded.size(); i++) {
+		if(contour[i].x != recorded[i].x || contour[i].y != recorded[i].y) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int runReplay(string path, bool paced) {
+	RecordingReader reader;
+	if(!reader.open(path)) {
+		return 1;
+	}
+	
+	ofxXmlSettings xml;
+	xml.loadFile("settings.xml");
+	HandOsc osc;
+	osc.setup(xml.getValue("host", "localhost"), xml.getValue("port", 8000), xml.getValue("bundled", 0));
+	
+	HandProcessor processor;
+	RecordedFrame frame;
+	int different = 0;
+	unsigned long long start = getMonotonicMicros(), first = 0;
+	for(int i = 0; i < reader.size(); i++) {
+		if(!reader.read(i, frame)) {
+			ofLogError() << "frame " << i << " of " << path << " is damaged";
+			break;
+		}
+		if(i == 0) {
+			first = frame.captured;
+		}
+		
+		// captured times are only meaningful to the finger tracker when the
+		// frames arrive at their original pace
+		unsigned long long captured = 0;
+		if(paced) {
+			captured = start + (frame.captured - first);
+			while(getMonotonicMicros() < captured) {
+				ofSleepMillis(1);
+			}
+		}
+		
+		processor.settings = frame.settings;
+		if(reader.getContent() == RECORDING_MASK) {
+			// the roi isn't recorded, but outside it the mask is empty anyway
+			processor.settings.tracking = false;
+			processor.updateThresholded(frame.image, captured);
+		} else {
+			processor.update(frame.image, captured);
+		}
+		vector<Hand>& hands = processor.getHands();
+		bool same = hands.empty() ? frame.contour.empty() : isSameContour(hands[0].contour, frame.contour);
+		if(!same) {
+			if(different < 10) {
+				ofLogWarning() << "frame " << frame.sequence << " chose a different contour";
+			}
+			different++;
+		}
+		osc.send(hands, processor.settings.multiHand, captured == 0 ? getMonotonicMicros() : captured, frame.sequence);
+	}
+	float seconds = (getMonotonicMicros() - start) / 1e6;
+	
+	cout << path << ": " << reader.size() << " frames, " << different << " with a different contour" << endl;
+	cout << (reader.size() / seconds) << " fps" << endl;
+	return different == 0 ? 0 : 1;
+}
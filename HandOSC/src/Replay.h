@@ -0,0 +1,12 @@
+#pragma once
+
+#include "HandProcessor.h"
+#include "HandOsc.h"
+#include "Recording.h"
+
+// feeds a recording back through HandProcessor with the parameters it was
+// recorded with, sending OSC as configured in settings.xml. paced replays
+// at the original frame times, otherwise as fast as possible. prints how
+// many frames chose a different contour than when they were recorded.
+// returns a process exit code so main() can hand it straight back.
+int runReplay(string path, bool paced = false);
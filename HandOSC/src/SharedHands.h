@@ -0,0 +1,198 @@
+#pragma once
+
+// the layout of the shared memory ring HandOSC writes hands into, and a
+// reader for it. this header only needs POSIX, so consumers can include it
+// without openFrameworks.
+//
+// the memory starts with a SharedHandsHeader followed by slotCount
+// SharedFrames. the writer fills slot (writeCount % slotCount) and then
+// increments writeCount. each slot has a sequence lock that is odd while
+// the slot is being written, so readers never block the writer and simply
+// retry when they catch a slot mid-write. the slot also records which frame
+// it holds, because the writer can fill it again before writeCount shows it.
+// HandOSC replaces the ring every time it starts, so a reader whose
+// writeCount stops advancing should open() again.
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+#define SHARED_HANDS_MAGIC 0x48414e44
+#define SHARED_HANDS_VERSION 2
+#define SHARED_HANDS_NAME "/handosc"
+#define SHARED_HANDS_MAX_HANDS 8
+#define SHARED_HANDS_MAX_FINGERS 8
+
+struct SharedFinger {
+	uint32_t id;
+	float x, y;
+	// extrapolated to hide latency, this is what OSC sends
+	float predictedX, predictedY;
+};
+
+struct SharedHand {
+	uint32_t id;
+	float area;
+	float centroidX, centroidY;
+	uint32_t fingerCount;
+	SharedFinger fingers[SHARED_HANDS_MAX_FINGERS];
+};
+
+struct SharedFrame {
+	// odd while the writer is filling this slot
+	volatile uint32_t lock;
+	// the frame id, the same as /hand/frame in bundled OSC
+	uint32_t sequence;
+	// microseconds from the monotonic clock, see SharedHandsReader::getMicros()
+	uint64_t captured, published;
+	// counting from 0 at the first frame written, see SharedHandsReader::read()
+	uint64_t index;
+	uint32_t handCount;
+	uint32_t padding;
+	SharedHand hands[SHARED_HANDS_MAX_HANDS];
+};
+
+struct SharedHandsHeader {
+	volatile uint32_t magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t frameSize;
+	// the number of frames written so far, the latest is writeCount - 1
+	volatile uint64_t writeCount;
+};
+
+inline size_t getSharedHandsSize(int slotCount) {
+	return sizeof(SharedHandsHeader) + slotCount * sizeof(SharedFrame);
+}
+
+// maps the ring read-only and copies frames out of it. any number of
+// readers can poll the same ring.
+class SharedHandsReader {
+public:
+	SharedHandsReader()
+	:header(NULL)
+	,slots(NULL)
+	,size(0) {
+	}
+	~SharedHandsReader() {
+		close();
+	}
+
+	// returns false if HandOSC isn't running with shared output enabled
+	bool open(const char* name = SHARED_HANDS_NAME) {
+		close();
+		int fd = shm_open(name, O_RDONLY, 0);
+		if(fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if(fstat(fd, &info) < 0 || info.st_size < (off_t) sizeof(SharedHandsHeader)) {
+			::close(fd);
+			return false;
+		}
+		void* memory = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if(memory == MAP_FAILED) {
+			return false;
+		}
+		header = (const SharedHandsHeader*) memory;
+		size = info.st_size;
+		if(header->magic != SHARED_HANDS_MAGIC ||
+			header->version != SHARED_HANDS_VERSION ||
+			header->frameSize != sizeof(SharedFrame) ||
+			size < getSharedHandsSize(header->slotCount)) {
+			close();
+			return false;
+		}
+		slots = (const SharedFrame*) (header + 1);
+		return true;
+	}
+	void close() {
+		if(header != NULL) {
+			munmap((void*) header, size);
+		}
+		header = NULL;
+		slots = NULL;
+		size = 0;
+	}
+	bool isOpen() const {
+		return header != NULL;
+	}
+
+	uint64_t getWriteCount() const {
+		return header->writeCount;
+	}
+	unsigned int getSlotCount() const {
+		return header->slotCount;
+	}
+	// copies the newest frame, returns false if nothing has been written
+	bool readLatest(SharedFrame& frame) const {
+		for(int attempt = 0; attempt < 4; attempt++) {
+			uint64_t count = getWriteCount();
+			if(count == 0) {
+				return false;
+			}
+			if(read(count - 1, frame)) {
+				return true;
+			}
+		}
+		return false;
+	}
+	// copies the frame with this index, counting from 0 at the first frame
+	// written. returns false if it hasn't been written yet, or if the writer
+	// has already lapped it.
+	bool read(uint64_t index, SharedFrame& frame) const {
+		if(index >= getWriteCount()) {
+			return false;
+		}
+		const SharedFrame& slot = slots[index % header->slotCount];
+		uint32_t before = slot.lock;
+		if(before & 1) {
+			return false;
+		}
+		__sync_synchronize();
+		frame.sequence = slot.sequence;
+		frame.captured = slot.captured;
+		frame.published = slot.published;
+		frame.index = slot.index;
+		frame.handCount = slot.handCount;
+		if(frame.handCount > SHARED_HANDS_MAX_HANDS) {
+			return false;
+		}
+		memcpy(frame.hands, (const void*) slot.hands, frame.handCount * sizeof(SharedHand));
+		__sync_synchronize();
+		if(slot.lock != before) {
+			return false;
+		}
+		// the slot is stable, but it may hold a newer frame than asked for
+		return frame.index == index;
+	}
+
+	// the same clock HandOSC stamps frames with, so readers can measure
+	// how old a frame is
+	static uint64_t getMicros() {
+#ifdef __APPLE__
+		static mach_timebase_info_data_t timebase;
+		if(timebase.denom == 0) {
+			mach_timebase_info(&timebase);
+		}
+		return mach_absolute_time() * timebase.numer / timebase.denom / 1000;
+#else
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+#endif
+	}
+
+protected:
+	const SharedHandsHeader* header;
+	const SharedFrame* slots;
+	size_t size;
+};
@@ -0,0 +1,106 @@
+#include "SharedHandsWriter.h"
+
+SharedHandsWriter::SharedHandsWriter()
+:header(NULL)
+,slots(NULL)
+,size(0) {
+}
+
+SharedHandsWriter::~SharedHandsWriter() {
+	close();
+}
+
+bool SharedHandsWriter::setup(string name, int slotCount) {
+	close();
+	this->name = name;
+	size = getSharedHandsSize(slotCount);
+	// a segment left behind by a crash can't be resized on os x, so it's
+	// always replaced. readers still attached keep the old one.
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0) {
+		ofLogError() << "couldn't create shared memory " << name;
+		return false;
+	}
+	if(ftruncate(fd, size) < 0) {
+		ofLogError() << "couldn't resize shared memory " << name;
+		::close(fd);
+		shm_unlink(name.c_str());
+		return false;
+	}
+	void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		ofLogError() << "couldn't map shared memory " << name;
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	// readers check the magic number last, so it's only set once the rest
+	// of the header is valid
+	header = (SharedHandsHeader*) memory;
+	slots = (SharedFrame*) (header + 1);
+	header->magic = 0;
+	__sync_synchronize();
+	memset(slots, 0, slotCount * sizeof(SharedFrame));
+	header->version = SHARED_HANDS_VERSION;
+	header->slotCount = slotCount;
+	header->frameSize = sizeof(SharedFrame);
+	header->writeCount = 0;
+	__sync_synchronize();
+	header->magic = SHARED_HANDS_MAGIC;
+	return true;
+}
+
+void SharedHandsWriter::close() {
+	if(header == NULL) {
+		return;
+	}
+	header->magic = 0;
+	munmap(header, size);
+	shm_unlink(name.c_str());
+	header = NULL;
+	slots = NULL;
+}
+
+bool SharedHandsWriter::isOpen() const {
+	return header != NULL;
+}
+
+void SharedHandsWriter::write(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence) {
+	uint64_t index = header->writeCount;
+	SharedFrame& frame = slots[index % header->slotCount];
+	frame.lock++;
+	__sync_synchronize();
+
+	int handCount = multiHand ? hands.size() : MIN(hands.size(), 1);
+	handCount = MIN(handCount, SHARED_HANDS_MAX_HANDS);
+	frame.sequence = sequence;
+	frame.captured = captured;
+	frame.index = index;
+	frame.handCount = handCount;
+	for(int i = 0; i < handCount; i++) {
+		Hand& hand = hands[i];
+		SharedHand& shared = frame.hands[i];
+		shared.id = hand.id;
+		shared.area = hand.area;
+		shared.centroidX = hand.centroid.x;
+		shared.centroidY = hand.centroid.y;
+		shared.fingerCount = MIN(hand.trackedFingers.size(), SHARED_HANDS_MAX_FINGERS);
+		for(int j = 0; j < shared.fingerCount; j++) {
+			TrackedFinger& finger = hand.trackedFingers[j];
+			SharedFinger& sharedFinger = shared.fingers[j];
+			sharedFinger.id = finger.id;
+			sharedFinger.x = finger.position.x;
+			sharedFinger.y = finger.position.y;
+			sharedFinger.predictedX = finger.predicted.x;
+			sharedFinger.predictedY = finger.predicted.y;
+		}
+	}
+	frame.published = getMonotonicMicros();
+
+	__sync_synchronize();
+	frame.lock++;
+	__sync_synchronize();
+	header->writeCount = index + 1;
+}
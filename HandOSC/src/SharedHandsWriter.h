@@ -0,0 +1,28 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Hand.h"
+#include "SharedHands.h"
+
+// publishes hands into a shared memory ring for consumers on the same
+// machine, see SharedHands.h for the layout and the reader. only one
+// thread may write.
+class SharedHandsWriter {
+public:
+	SharedHandsWriter();
+	~SharedHandsWriter();
+
+	bool setup(string name = SHARED_HANDS_NAME, int slotCount = 16);
+	void close();
+	bool isOpen() const;
+
+	// hands past SHARED_HANDS_MAX_HANDS, or fingers past
+	// SHARED_HANDS_MAX_FINGERS, are left out
+	void write(vector<Hand>& hands, bool multiHand, unsigned long long captured, unsigned int sequence);
+
+protected:
+	string name;
+	SharedHandsHeader* header;
+	SharedFrame* slots;
+	size_t size;
+};
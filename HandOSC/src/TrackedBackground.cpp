@@ -0,0 +1,167 @@
+#include "TrackedBackground.h"
+
+using namespace ofxCv;
+using namespace cv;
+
+// how many frame rows of stale background are refreshed per update
+static const int refreshRows = 16;
+
+// Rect's | doesn't treat an empty rect as empty
+static Rect getUnion(const Rect& a, const Rect& b) {
+	if(a.area() == 0) {
+		return b;
+	}
+	if(b.area() == 0) {
+		return a;
+	}
+	return a | b;
+}
+
+TrackedBackground::TrackedBackground()
+:levels(2)
+,margin(32)
+,refreshRow(0)
+,learningTime(900)
+,minArea(400)
+,needToReset(true) {
+}
+
+void TrackedBackground::setPyramidLevels(int levels) {
+	this->levels = levels;
+}
+
+void TrackedBackground::setMargin(int margin) {
+	this->margin = margin;
+}
+
+void TrackedBackground::setLearningTime(float learningTime) {
+	this->learningTime = learningTime;
+}
+
+void TrackedBackground::setMinArea(float minArea) {
+	this->minArea = minArea;
+}
+
+void TrackedBackground::reset() {
+	coarseBackground.reset();
+	tracked = Rect();
+	needToReset = true;
+}
+
+void TrackedBackground::update(Mat frame, Mat& thresholded, float threshold) {
+	frameRect = Rect(0, 0, frame.cols, frame.rows);
+	if(needToReset || thresholded.size() != frame.size()) {
+		toGray(frame, frameRect);
+		gray.convertTo(accumulator, CV_32F);
+		thresholded.create(frame.rows, frame.cols, CV_8UC1);
+		thresholded.setTo(0);
+		roi = Rect();
+		needToReset = false;
+	}
+	
+	Rect coarseBounds = findCoarseBounds(frame, threshold);
+	Rect next = getUnion(coarseBounds, tracked);
+	if(next.area() == 0) {
+		next = frameRect;
+	} else {
+		next = Rect(next.x - margin, next.y - margin, next.width + 2 * margin, next.height + 2 * margin) & frameRect;
+	}
+	
+	// only the part of the mask written last frame needs clearing
+	if(roi.area() > 0) {
+		thresholded(roi).setTo(0);
+	}
+	roi = next;
+	
+	toGray(frame, roi);
+	Mat accumulatorRoi = accumulator(roi), grayRoi = gray(roi);
+	accumulatorRoi.convertTo(background, CV_8U);
+	absdiff(background, grayRoi, difference);
+	Mat thresholdedRoi = thresholded(roi);
+	cv::threshold(difference, thresholdedRoi, threshold, 255, CV_THRESH_BINARY);
+	accumulateWeighted(grayRoi, accumulatorRoi, 1. / learningTime);
+	
+	if(roi != frameRect) {
+		refresh(frame);
+	}
+}
+
+// converts only the given part of the frame into gray
+void TrackedBackground::toGray(Mat& frame, Rect rect) {
+	gray.create(frame.rows, frame.cols, CV_8UC1);
+	Mat grayRect = gray(rect);
+	if(frame.channels() == 1) {
+		frame(rect).copyTo(grayRect);
+	} else {
+		cvtColor(frame(rect), grayRect, CV_RGB2GRAY);
+	}
+}
+
+Rect TrackedBackground::findCoarseBounds(Mat& frame, float threshold) {
+	// a single area-averaging pass is the only full resolution work
+	int scale = 1 << levels;
+	resize(frame, coarse, cv::Size(frame.cols / scale, frame.rows / scale), 0, 0, CV_INTER_AREA);
+	coarseBackground.setThresholdValue(threshold);
+	coarseBackground.update(coarse, coarseThresholded);
+	
+	float coarseMinArea = minArea / (scale * scale);
+	coarseThresholded.copyTo(coarseContourMask);
+	cv::findContours(coarseContourMask, coarseContours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+	Rect bounds;
+	for(int i = 0; i < coarseContours.size(); i++) {
+		if(contourArea(coarseContours[i]) >= coarseMinArea) {
+			bounds = getUnion(bounds, boundingRect(coarseContours[i]));
+		}
+	}
+	return Rect(bounds.x * scale, bounds.y * scale, bounds.width * scale, bounds.height * scale);
+}
+
+// keep the background outside the roi learning, a stripe at a time. the
+// roi already learns every frame, so it's cut out of the stripe.
+void TrackedBackground::refresh(Mat& frame) {
+	if(refreshRow >= frame.rows) {
+		refreshRow = 0;
+	}
+	Rect stripe(0, refreshRow, frame.cols, MIN(refreshRows, frame.rows - refreshRow));
+	// each row comes around every rows / refreshRows frames, learn that much faster
+	float rate = MIN(1, (float) frame.rows / refreshRows / learningTime);
+	Rect overlap = stripe & roi;
+	if(overlap.area() == 0) {
+		learn(frame, stripe, rate);
+	} else {
+		learn(frame, Rect(stripe.x, stripe.y, stripe.width, overlap.y - stripe.y), rate);
+		learn(frame, Rect(stripe.x, overlap.br().y, stripe.width, stripe.br().y - overlap.br().y), rate);
+		learn(frame, Rect(stripe.x, overlap.y, overlap.x - stripe.x, overlap.height), rate);
+		learn(frame, Rect(overlap.br().x, overlap.y, stripe.br().x - overlap.br().x, overlap.height), rate);
+	}
+	refreshRow += refreshRows;
+}
+
+void TrackedBackground::learn(Mat& frame, Rect rect, float rate) {
+	if(rect.area() == 0) {
+		return;
+	}
+	toGray(frame, rect);
+	Mat accumulatorRect = accumulator(rect);
+	accumulateWeighted(gray(rect), accumulatorRect, rate);
+}
+
+void TrackedBackground::track(Rect bounds) {
+	tracked = bounds;
+}
+
+Rect TrackedBackground::getRoi() const {
+	return roi;
+}
+
+bool TrackedBackground::isTracking() const {
+	return roi.area() > 0 && roi != frameRect;
+}
+
+float TrackedBackground::getPixelFraction() const {
+	return frameRect.area() > 0 ? (float) roi.area() / frameRect.area() : 1;
+}
+
+Mat& TrackedBackground::getCoarseThresholded() {
+	return coarseThresholded;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+// background subtraction that only touches the full resolution frame where
+// the hands are. every frame is downsampled to a coarse pyramid level and
+// background subtracted there to find roughly where anything is moving.
+// the full resolution background is then updated and thresholded only
+// inside that box combined with where the hands were last frame, plus a
+// margin for motion. when neither level has anything to offer the whole
+// frame is processed, as if untracked. outside the region a few rows of
+// background are refreshed each frame so it doesn't go stale while a hand
+// sits still.
+class TrackedBackground {
+public:
+	TrackedBackground();
+	
+	// each level halves the size of the coarse frame
+	void setPyramidLevels(int levels);
+	void setMargin(int margin);
+	void setLearningTime(float learningTime);
+	void setMinArea(float minArea);
+	void reset();
+	
+	// thresholded is frame sized and zero outside getRoi()
+	void update(cv::Mat frame, cv::Mat& thresholded, float threshold);
+	// where the hands ended up this frame, an empty rect when there were none
+	void track(cv::Rect bounds);
+	
+	cv::Rect getRoi() const;
+	bool isTracking() const;
+	// the share of full resolution pixels thresholded in the last update
+	float getPixelFraction() const;
+	cv::Mat& getCoarseThresholded();
+	
+protected:
+	void toGray(cv::Mat& frame, cv::Rect rect);
+	cv::Rect findCoarseBounds(cv::Mat& frame, float threshold);
+	void refresh(cv::Mat& frame);
+	void learn(cv::Mat& frame, cv::Rect rect, float rate);
+	
+	int levels, margin, refreshRow;
+	float learningTime, minArea;
+	bool needToReset;
+	
+	ofxCv::RunningBackground coarseBackground;
+	cv::Mat coarse, coarseThresholded, coarseContourMask;
+	vector< vector<cv::Point> > coarseContours;
+	
+	cv::Mat gray, accumulator, background, difference;
+	cv::Rect frameRect, roi, tracked;
+};
@@ -0,0 +1,265 @@
+#include "V4L2Source.h"
+
+#ifdef TARGET_LINUX
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+using namespace cv;
+
+V4L2Source::V4L2Source(int width, int height, int bufferCount)
+:width(width)
+,height(height)
+,bytesPerLine(width)
+,bufferCount(bufferCount)
+,format(0)
+,frameRate(30)
+,fd(-1)
+,current(-1)
+,captured(0)
+,dropped(0) {
+}
+
+V4L2Source::~V4L2Source() {
+	close();
+}
+
+int V4L2Source::size() {
+	return 0;
+}
+
+float V4L2Source::getFrameRate() {
+	return frameRate;
+}
+
+bool V4L2Source::isLive() {
+	return true;
+}
+
+unsigned long long V4L2Source::getCaptured() {
+	return captured;
+}
+
+unsigned int V4L2Source::getDroppedFrames() {
+	return dropped;
+}
+
+#ifdef TARGET_LINUX
+
+// retries calls interrupted by a signal
+static int xioctl(int fd, unsigned long request, void* arg) {
+	int result;
+	do {
+		result = ioctl(fd, request, arg);
+	} while(result < 0 && errno == EINTR);
+	return result;
+}
+
+bool V4L2Source::open(string path) {
+	close();
+	fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+	if(fd < 0) {
+		ofLogError() << "couldn't open camera " << path;
+		return false;
+	}
+	v4l2_capability capability;
+	if(xioctl(fd, VIDIOC_QUERYCAP, &capability) < 0 ||
+		!(capability.capabilities & V4L2_CAP_VIDEO_CAPTURE) ||
+		!(capability.capabilities & V4L2_CAP_STREAMING)) {
+		ofLogError() << path << " can't stream video";
+		close();
+		return false;
+	}
+	// gray needs no conversion at all, YUYV only needs the Y plane
+	if(!setFormat(V4L2_PIX_FMT_GREY) && !setFormat(V4L2_PIX_FMT_YUYV)) {
+		ofLogError() << path << " doesn't support GREY or YUYV at " << width << "x" << height;
+		close();
+		return false;
+	}
+	
+	v4l2_streamparm parameters;
+	memset(&parameters, 0, sizeof(parameters));
+	parameters.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if(xioctl(fd, VIDIOC_G_PARM, &parameters) == 0) {
+		v4l2_fract& period = parameters.parm.capture.timeperframe;
+		if(period.numerator > 0) {
+			frameRate = (float) period.denominator / period.numerator;
+		}
+	}
+	
+	v4l2_requestbuffers request;
+	memset(&request, 0, sizeof(request));
+	request.count = bufferCount;
+	request.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	request.memory = V4L2_MEMORY_MMAP;
+	if(xioctl(fd, VIDIOC_REQBUFS, &request) < 0 || request.count < 2) {
+		ofLogError() << path << " doesn't support memory mapped buffers";
+		close();
+		return false;
+	}
+	for(int i = 0; i < request.count; i++) {
+		v4l2_buffer buffer;
+		memset(&buffer, 0, sizeof(buffer));
+		buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		buffer.memory = V4L2_MEMORY_MMAP;
+		buffer.index = i;
+		if(xioctl(fd, VIDIOC_QUERYBUF, &buffer) < 0) {
+			close();
+			return false;
+		}
+		void* memory = mmap(NULL, buffer.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, buffer.m.offset);
+		if(memory == MAP_FAILED) {
+			ofLogError() << "couldn't map buffer " << i << " of " << path;
+			close();
+			return false;
+		}
+		buffers.push_back(memory);
+		lengths.push_back(buffer.length);
+		enqueue(i);
+	}
+	
+	v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	if(xioctl(fd, VIDIOC_STREAMON, &type) < 0) {
+		ofLogError() << "couldn't start streaming from " << path;
+		close();
+		return false;
+	}
+	current = -1;
+	dropped = 0;
+	return true;
+}
+
+bool V4L2Source::setFormat(unsigned int format) {
+	v4l2_format requested;
+	memset(&requested, 0, sizeof(requested));
+	requested.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	requested.fmt.pix.width = width;
+	requested.fmt.pix.height = height;
+	requested.fmt.pix.pixelformat = format;
+	requested.fmt.pix.field = V4L2_FIELD_NONE;
+	if(xioctl(fd, VIDIOC_S_FMT, &requested) < 0 || requested.fmt.pix.pixelformat != format) {
+		return false;
+	}
+	// the driver may pick the nearest size it supports
+	width = requested.fmt.pix.width;
+	height = requested.fmt.pix.height;
+	bytesPerLine = requested.fmt.pix.bytesperline;
+	this->format = format;
+	return true;
+}
+
+void V4L2Source::close() {
+	if(fd >= 0) {
+		v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		xioctl(fd, VIDIOC_STREAMOFF, &type);
+	}
+	for(int i = 0; i < buffers.size(); i++) {
+		munmap(buffers[i], lengths[i]);
+	}
+	buffers.clear();
+	lengths.clear();
+	if(fd >= 0) {
+		::close(fd);
+	}
+	fd = -1;
+	current = -1;
+}
+
+// takes a filled buffer from the driver without waiting
+bool V4L2Source::dequeue(int& index, unsigned long long& captured) {
+	v4l2_buffer buffer;
+	memset(&buffer, 0, sizeof(buffer));
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	if(xioctl(fd, VIDIOC_DQBUF, &buffer) < 0) {
+		return false;
+	}
+	index = buffer.index;
+	// driver timestamps are usually from the same clock as getMonotonicMicros()
+	if((buffer.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+		captured = buffer.timestamp.tv_sec * 1000000ULL + buffer.timestamp.tv_usec;
+	} else {
+		captured = getMonotonicMicros();
+	}
+	return true;
+}
+
+void V4L2Source::enqueue(int index) {
+	v4l2_buffer buffer;
+	memset(&buffer, 0, sizeof(buffer));
+	buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	buffer.memory = V4L2_MEMORY_MMAP;
+	buffer.index = index;
+	xioctl(fd, VIDIOC_QBUF, &buffer);
+}
+
+bool V4L2Source::read(Mat& frame) {
+	if(fd < 0) {
+		return false;
+	}
+	// the caller is done with the last frame
+	if(current >= 0) {
+		enqueue(current);
+		current = -1;
+	}
+	
+	int index;
+	while(!dequeue(index, captured)) {
+		if(errno != EAGAIN) {
+			ofLogError() << "lost the camera";
+			return false;
+		}
+		pollfd ready;
+		ready.fd = fd;
+		ready.events = POLLIN;
+		int polled = poll(&ready, 1, 1000);
+		if(isStopping()) {
+			return false;
+		}
+		if(polled == 0) {
+			ofLogWarning() << "no frame from the camera for a second";
+		}
+	}
+	// skip to the newest frame, latency matters more than every frame
+	int newer;
+	unsigned long long newerCaptured;
+	while(dequeue(newer, newerCaptured)) {
+		enqueue(index);
+		index = newer;
+		captured = newerCaptured;
+		dropped++;
+	}
+	current = index;
+	
+	if(format == V4L2_PIX_FMT_GREY) {
+		frame = Mat(height, width, CV_8UC1, buffers[index], bytesPerLine);
+	} else {
+		Mat yuyv(height, width, CV_8UC2, buffers[index], bytesPerLine);
+		gray.create(height, width, CV_8UC1);
+		int fromTo[] = {0, 0};
+		mixChannels(&yuyv, 1, &gray, 1, fromTo, 1);
+		frame = gray;
+	}
+	return true;
+}
+
+#else
+
+bool V4L2Source::open(string path) {
+	ofLogError() << "V4L2 cameras are only supported on Linux";
+	return false;
+}
+
+void V4L2Source::close() {
+}
+
+bool V4L2Source::read(Mat& frame) {
+	return false;
+}
+
+#endif
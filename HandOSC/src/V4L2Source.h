@@ -0,0 +1,40 @@
+#pragma once
+
+#include "FrameSource.h"
+
+// a Linux camera read straight from the driver's memory mapped buffers.
+// read() hands out the newest filled buffer and gives the previous one
+// back to the driver, so no frame is copied unless the camera only
+// delivers YUYV, when the Y plane is taken out as the gray frame. older
+// frames that were waiting are returned unread and counted as dropped.
+// on other platforms open() always fails.
+class V4L2Source : public FrameSource {
+public:
+	V4L2Source(int width, int height, int bufferCount = 4);
+	~V4L2Source();
+	bool open(string path);
+	void close();
+	bool read(cv::Mat& frame);
+	int size();
+	float getFrameRate();
+	bool isLive();
+	unsigned long long getCaptured();
+	unsigned int getDroppedFrames();
+
+protected:
+	bool setFormat(unsigned int format);
+	bool dequeue(int& index, unsigned long long& captured);
+	void enqueue(int index);
+
+	int width, height, bytesPerLine, bufferCount;
+	unsigned int format;
+	float frameRate;
+	int fd;
+	vector<void*> buffers;
+	vector<size_t> lengths;
+	// the buffer frame points into, -1 before the first read
+	int current;
+	unsigned long long captured;
+	unsigned int dropped;
+	cv::Mat gray;
+};
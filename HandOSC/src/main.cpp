@@ -1,8 +1,68 @@
+#include "Benchmark.h"
+#include "Replay.h"
+#include "Batch.h"
+#include "Daemon.h"
+
+// the headless build defines HANDOSC_HEADLESS and leaves out testApp.cpp
+// and ofxUI, so it never needs a display
+#ifndef HANDOSC_HEADLESS
 #include "testApp.h"
 #include "ofAppGlutWindow.h"
+#endif
 
-int main() {
+int main(int argc, char* argv[]) {
+	// HandOSC --benchmark <video or image directory> [--multi] [--track]
+	//	[--largest] [--hull] [--compare]
+	if(argc > 2 && string(argv[1]) == "--benchmark") {
+		HandSettings settings;
+		bool compare = false;
+		for(int i = 3; i < argc; i++) {
+			string arg = argv[i];
+			settings.multiHand |= arg == "--multi";
+			settings.tracking |= arg == "--track";
+			settings.largestBlob |= arg == "--largest";
+			settings.hullFingers |= arg == "--hull";
+			compare |= arg == "--compare";
+		}
+		return compare ? runComparison(argv[2], settings) : runBenchmark(argv[2], settings);
+	}
+	
+	// HandOSC --batch <video> <output.csv or .osc> [--multi] [--largest]
+	//	[--hull] [--threads <n>] [<setting>=<value>,<value>...]
+	if(argc > 3 && string(argv[1]) == "--batch") {
+		HandSettings settings;
+		vector<string> sweep;
+		int threads = 0;
+		for(int i = 4; i < argc; i++) {
+			string arg = argv[i];
+			if(arg == "--threads" && i + 1 < argc) {
+				threads = ofToInt(argv[++i]);
+			} else if(ofIsStringInString(arg, "=")) {
+				sweep.push_back(arg);
+			}
+			settings.multiHand |= arg == "--multi";
+			settings.largestBlob |= arg == "--largest";
+			settings.hullFingers |= arg == "--hull";
+		}
+		return runBatch(argv[2], argv[3], getSweep(settings, sweep), threads);
+	}
+	
+	// HandOSC --replay <recording.hand> [--paced]
+	if(argc > 2 && string(argv[1]) == "--replay") {
+		bool paced = argc > 3 && string(argv[3]) == "--paced";
+		return runReplay(argv[2], paced);
+	}
+	
+	// HandOSC --daemon [<camera, video, recording, raw file or ->]
+	if(argc > 1 && string(argv[1]) == "--daemon") {
+		return runDaemon(argc > 2 ? argv[2] : "");
+	}
+	
+#ifdef HANDOSC_HEADLESS
+	return runDaemon();
+#else
 	ofAppGlutWindow window;
 	ofSetupOpenGL(&window, 640, 480, OF_WINDOW);
 	ofRunApp(new testApp());
+#endif
 }
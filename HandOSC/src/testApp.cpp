@@ -3,155 +3,133 @@
 using namespace ofxCv;
 using namespace cv;
 
-vector<float> buildContourAnalysis(ofPolyline& polyline, int offset) {
-	int n = polyline.size();
-	if(offset > n) {
-		offset = n;
-	}
-	vector<float> curvature(n);
-	for(int i = 0; i < n; i++) {
-		int left = i - offset;
-		if(left < 0) {
-			left += n;
-		}
-		int right = i + offset;
-		if(right >= n) {
-			right -= n;
-		}
-		ofVec2f a = polyline[left], b = polyline[i], c = polyline[right];
-		a -= b;
-		c -= b;
-		float angle = a.angle(c);
-		curvature[i] = -(angle > 0 ? angle - 180 : angle + 180);
-	}
-	return curvature;
-}
-
-vector<int> findPeaks(vector<float>& values, float cutoff, int peakArea) {
-	vector< pair<float, int> > peaks;
-	int n = values.size();
-	for(int i = 1; i < n - 1; i++) {
-		if(values[i] > cutoff) {
-			peaks.push_back(pair<float, int>(-values[i], i));
-		}
-	}
-	ofSort(peaks);
-	vector<int> indices;
-	for(int i = 0; i < peaks.size(); i++) {
-		int curIndex = peaks[i].second;
-		bool hasNeighbor = false;
-		for(int j = 0; j < indices.size(); j++) {
-			if(abs(curIndex - indices[j]) < peakArea || abs((curIndex + n) - indices[j]) < peakArea) {
-				hasNeighbor = true;
-				break;
-			}
-		}
-		if(!hasNeighbor) {
-			indices.push_back(curIndex);
-		}
-	}
-	return indices;
-}
-
 void testApp::setup() {
 	ofSetVerticalSync(true);
 	ofSetFrameRate(120);
-	cam.initGrabber(640, 480);
-	contourFinder.setMinAreaRadius(10);
-	contourFinder.setMaxAreaRadius(400);
 	
 	ofxXmlSettings xml;
 	xml.loadFile("settings.xml");
 	string host = xml.getValue("host", "localhost");
 	int port = xml.getValue("port", 8000);
-	osc.setup(host, port);
+	bool bundled = xml.getValue("bundled", 0);
+	osc.setup(host, port, bundled);
+	// local consumers can read hands from shared memory instead of OSC
+	if(xml.getValue("shared", 0)) {
+		osc.setupShared(xml.getValue("sharedName", SHARED_HANDS_NAME));
+	}
+	sequence = 0;
+	
+	// stats are summarized every statsInterval seconds, sent as /stats and
+	// optionally appended to a csv file in the data folder
+	stats.setup(xml.getValue("statsInterval", 1.0), xml.getValue("statsLog", ""));
+	showStats = true;
+	
+	// 'r' records what the pipeline sees, see Recording.h
+	recordContent = xml.getValue("recordMasks", 0) ? RECORDING_MASK : RECORDING_GRAY;
+	recordCompressed = xml.getValue("recordCompressed", 1);
+	
+	// capture and processing run on their own threads, draw() only shows results
+	pipelined = xml.getValue("pipelined", 0);
+	if(pipelined) {
+		pipeline.setup(640, 480, osc, stats, recorder);
+	} else {
+		cam.initGrabber(640, 480);
+	}
 	
-	threshold = 64;
-	smoothing = 10;
-	sampleOffset = 60;
-	peakAngleCutoff = 45;
-	peakNeighborDistance = 60;
 	clearBackground = false;
 	
 	gui = new ofxUICanvas();
 	gui->addLabel("Hand OSC");
 	gui->addSpacer();
-	gui->addSlider("Threshold", 0.0, 255.0, &threshold);
-	gui->addSlider("Smoothing", 0.0, 20, &smoothing);
-	gui->addSlider("Sample offset", 0.0, 100, &sampleOffset);
-	gui->addSlider("Peak angle cutoff", 0, 90, &peakAngleCutoff);
-	gui->addSlider("Peak neighbor distance", 0, 100, &peakNeighborDistance);
+	HandSettings& settings = getSettings();
+	gui->addSlider("Threshold", 0.0, 255.0, &settings.threshold);
+	gui->addSlider("Smoothing", 0.0, 20, &settings.smoothing);
+	gui->addSlider("Sample offset", 0.0, 100, &settings.sampleOffset);
+	gui->addSlider("Peak angle cutoff", 0, 90, &settings.peakAngleCutoff);
+	gui->addSlider("Peak neighbor distance", 0, 100, &settings.peakNeighborDistance);
+	gui->addSpacer();
+	gui->addToggle("Multi hand", &settings.multiHand);
+	gui->addSlider("Min hand area", 0, 20000, &settings.minHandArea);
+	gui->addToggle("Track ROI", &settings.tracking);
+	gui->addToggle("Largest blob", &settings.largestBlob);
+	gui->addToggle("Hull fingers", &settings.hullFingers);
+	gui->addSlider("Defect depth", 0, 100, &settings.minDefectDepth);
+	gui->addSlider("Prediction (ms)", 0, 100, &settings.predictionLatency);
 	gui->addSpacer();
 	gui->addLabelButton("Clear background", &clearBackground);
 	gui->autoSizeToFitWidgets();
 }
 
+void testApp::exit() {
+	pipeline.stop();
+	recorder.close();
+}
+
 void testApp::update() {
 	if(clearBackground) {
-		runningBackground.reset();
+		resetBackground();
+	}
+	if(pipelined) {
+		if(pipeline.update()) {
+			HandResult& result = pipeline.getResult();
+			copy(result.frame, frame);
+			frame.update();
+			copy(result.thresholded, thresholded);
+			thresholded.update();
+		}
+		return;
 	}
 	cam.update();
 	if(cam.isFrameNew()) {
-		runningBackground.setThresholdValue(threshold);
-		runningBackground.update(cam, thresholded);
-		thresholded.update();
-		contourFinder.findContours(thresholded);
-		if(contourFinder.size() > 0) {
-			float maxArea = 0;
-			int maxAreaIndex = 0;
-			for(int i = 0; i < contourFinder.size(); i++) {
-				float curArea = contourFinder.getContourArea(i);
-				if(curArea > maxArea) {
-					maxArea = curArea;
-					maxAreaIndex = i;
-				}
-			}
-			area = maxArea;
-			centroid = toOf(contourFinder.getCentroid(maxAreaIndex));
-			biggest = contourFinder.getPolyline(maxAreaIndex);
-			resampled = biggest.getResampledBySpacing(1);
-			resampled = resampled.getSmoothed(smoothing);
-			
-			int padding = 8;
-			curvature = buildContourAnalysis(resampled, sampleOffset);
-			peaks = findPeaks(curvature, peakAngleCutoff, peakNeighborDistance);
-			fingers.clear();
-			for(int i = 0; i < peaks.size(); i++) {
-				ofVec2f finger = resampled[peaks[i]];
-				if(finger.y < ofGetHeight() - padding) {
-					fingers.push_back(finger);
-				}
-			}
-			
-			sendOsc();
+		FrameTimes times;
+		times.captured = getMonotonicMicros();
+		times.started = times.captured;
+		recorder.update(processor, toCv(cam), times.captured, sequence);
+		times.processed = getMonotonicMicros();
+		osc.send(processor.getHands(), processor.settings.multiHand, times.captured, sequence++);
+		times.sent = getMonotonicMicros();
+		stats.add(processor, times);
+		if(stats.update()) {
+			osc.sendStats(stats.getSummary());
 		}
+		copy(processor.getThresholded(), thresholded);
+		thresholded.update();
 	}
 }
 
-void testApp::sendOsc() {
-	ofxOscMessage handSize;
-	handSize.setAddress("/hand/size");
-	handSize.addFloatArg(sqrtf(area));
-	osc.sendMessage(handSize);
-	
-	ofxOscMessage handPosition;
-	handPosition.setAddress("/hand/position");
-	handPosition.addFloatArg(centroid.x);
-	handPosition.addFloatArg(centroid.y);
-	osc.sendMessage(handPosition);
-	
-	for(int i = 0; i < fingers.size(); i++) {
-		ofxOscMessage fingerPosition;
-		fingerPosition.setAddress("/hand/finger/" + ofToString(i));
-		fingerPosition.addFloatArg(fingers[i].x);
-		fingerPosition.addFloatArg(fingers[i].y);
-		osc.sendMessage(fingerPosition);
+HandSettings& testApp::getSettings() {
+	return pipelined ? pipeline.getSettings() : processor.settings;
+}
+
+vector<Hand>& testApp::getHands() {
+	return pipelined ? pipeline.getResult().hands : processor.getHands();
+}
+
+void testApp::resetBackground() {
+	if(pipelined) {
+		pipeline.reset();
+	} else {
+		processor.reset();
+	}
+}
+
+void testApp::toggleRecording() {
+	if(recorder.isOpen()) {
+		recorder.close();
+	} else {
+		recorder.open("recording-" + ofGetTimestampString() + ".hand", 640, 480, recordContent, recordCompressed);
 	}
 }
 
 void testApp::draw() {
+	vector<Hand>& hands = getHands();
+	
 	ofSetColor(255);
-	cam.draw(0, 0);
+	if(pipelined) {
+		frame.draw(0, 0);
+	} else {
+		cam.draw(0, 0);
+	}
 	
 	ofEnableBlendMode(OF_BLENDMODE_ADD);
 	ofSetColor(255, 64);
@@ -159,17 +137,72 @@ void testApp::draw() {
 	
 	ofEnableBlendMode(OF_BLENDMODE_ALPHA);
 	ofSetLineWidth(3);
-	ofSetColor(255);
-	resampled.draw();
-	ofSetColor(magentaPrint);
 	ofNoFill();
-	for(int i = 0; i < fingers.size(); i++) {
-		ofLine(centroid, fingers[i]);
+	for(int i = 0; i < hands.size(); i++) {
+		Hand& hand = hands[i];
+		ofSetColor(255);
+		if(getSettings().hullFingers) {
+			hand.contour.draw();
+			for(int j = 0; j < hand.valleys.size(); j++) {
+				ofCircle(hand.contour[hand.valleys[j]], 4);
+			}
+		} else {
+			hand.resampled.draw();
+		}
+		ofSetColor(magentaPrint);
+		for(int j = 0; j < hand.trackedFingers.size(); j++) {
+			TrackedFinger& finger = hand.trackedFingers[j];
+			ofLine(hand.centroid, finger.position);
+			ofCircle(finger.predicted, 4);
+			ofDrawBitmapString(ofToString(finger.id), finger.position);
+		}
+		if(getSettings().multiHand) {
+			ofDrawBitmapStringHighlight(ofToString(hand.id), hand.centroid);
+		}
 	}
+	
+	if(!pipelined && getSettings().tracking) {
+		ofSetColor(cyanPrint);
+		ofRect(toOf(processor.getTrackedBackground().getRoi()));
+	}
+	
+	if(pipelined) {
+		ofDrawBitmapStringHighlight("dropped " + ofToString(pipeline.getDroppedFrames()), 10, ofGetHeight() - 10);
+	}
+	
+	if(showStats) {
+		drawStats();
+	}
+	
+	if(recorder.isOpen()) {
+		ofDrawBitmapStringHighlight("recording", 10, 20, ofColor::red);
+	}
+}
+
+// the latest stats summary as a table in the bottom right corner
+void testApp::drawStats() {
+	const StatsSummary& summary = stats.getSummary();
+	string table = ofToString(summary.fps, 1) + " fps\n";
+	table += "stage      p50   p99   max (us)\n";
+	for(int i = 0; i < STAT_COUNT; i++) {
+		string name = getStatName(i);
+		name.resize(10, ' ');
+		table += name
+			+ " " + ofToString(summary.p50[i], 5, ' ')
+			+ " " + ofToString(summary.p99[i], 5, ' ')
+			+ " " + ofToString(summary.max[i], 5, ' ') + "\n";
+	}
+	ofDrawBitmapStringHighlight(table, ofGetWidth() - 280, ofGetHeight() - 14 * (STAT_COUNT + 2));
 }
 
 void testApp::keyPressed(int key) {
 	if(key == ' ') {
-		runningBackground.reset();
+		resetBackground();
 	}
-}
\ No newline at end of file
+	if(key == 's') {
+		showStats = !showStats;
+	}
+	if(key == 'r') {
+		toggleRecording();
+	}
+}
@@ -2,32 +2,43 @@
 
 #include "ofMain.h"
 #include "ofxCv.h"
-#include "ofxOsc.h"
 #include "ofxUI.h"
+#include "HandProcessor.h"
+#include "HandPipeline.h"
+#include "HandOsc.h"
+#include "HandStats.h"
+#include "Recording.h"
 
 class testApp : public ofBaseApp {
 public:
 	void setup();
 	void update();
 	void draw();
+	void exit();
 	
 	void keyPressed(int key);
 	
-	void sendOsc();
+	HandSettings& getSettings();
+	vector<Hand>& getHands();
+	void resetBackground();
+	void drawStats();
+	void toggleRecording();
+	
+	bool pipelined;
+	HandPipeline pipeline;
+	ofImage frame;
 	
 	ofVideoGrabber cam;	
-	ofxCv::RunningBackground runningBackground;
+	HandProcessor processor;
 	ofImage thresholded;
-	ofxCv::ContourFinder contourFinder;
-	ofPolyline biggest, resampled;
-	vector<float> curvature;
-	vector<int> peaks;
-	vector<ofVec2f> fingers;
-	float area;
-	ofVec2f centroid;
-	ofxOscSender osc;
+	HandOsc osc;
+	unsigned int sequence;
+	HandStats stats;
+	bool showStats;
+	RecordingWriter recorder;
+	RecordingContent recordContent;
+	bool recordCompressed;
 	
 	ofxUICanvas* gui;
-	float threshold, smoothing, sampleOffset, peakAngleCutoff, peakNeighborDistance;
 	bool clearBackground;
 };
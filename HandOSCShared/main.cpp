@@ -0,0 +1,86 @@
+// reads hands from a running HandOSC with <shared>1</shared> in its
+// settings.xml, and prints them along with how long they took to arrive.
+//
+//	c++ -O2 -o HandOSCShared main.cpp (add -lrt on older Linux)
+//	./HandOSCShared [--all] [name]
+//
+// by default it polls for the latest frame, with --all it follows the ring
+// and reads every frame, counting the ones it was too slow to catch.
+
+#include <stdio.h>
+#include <string.h>
+#include "../HandOSC/src/SharedHands.h"
+
+int main(int argc, char* argv[]) {
+	bool all = false;
+	const char* name = SHARED_HANDS_NAME;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "--all") == 0) {
+			all = true;
+		} else {
+			name = argv[i];
+		}
+	}
+
+	SharedHandsReader reader;
+	while(!reader.open(name)) {
+		printf("waiting for %s\n", name);
+		sleep(1);
+	}
+
+	SharedFrame frame;
+	uint64_t next = reader.getWriteCount();
+	uint64_t lastReport = SharedHandsReader::getMicros();
+	unsigned int frames = 0, missed = 0;
+	uint64_t totalAge = 0, totalRead = 0;
+	while(true) {
+		uint64_t start = SharedHandsReader::getMicros();
+		bool found;
+		if(all) {
+			found = reader.read(next, frame);
+			uint64_t count = reader.getWriteCount();
+			if(!found && count - next >= reader.getSlotCount()) {
+				// lapped by the writer, skip to the oldest frame still there
+				uint64_t oldest = count - reader.getSlotCount() + 1;
+				missed += oldest - next;
+				next = oldest;
+				continue;
+			}
+			if(found) {
+				next++;
+			}
+		} else {
+			found = reader.readLatest(frame) && reader.getWriteCount() != next;
+			if(found) {
+				next = reader.getWriteCount();
+			}
+		}
+		uint64_t now = SharedHandsReader::getMicros();
+		if(found) {
+			frames++;
+			totalRead += now - start;
+			totalAge += now - frame.published;
+			for(unsigned int i = 0; i < frame.handCount; i++) {
+				SharedHand& hand = frame.hands[i];
+				printf("frame %u hand %u area %.0f at %.1f %.1f, %u fingers",
+					frame.sequence, hand.id, hand.area, hand.centroidX, hand.centroidY, hand.fingerCount);
+				for(unsigned int j = 0; j < hand.fingerCount; j++) {
+					printf(" %u:%.0f,%.0f", hand.fingers[j].id, hand.fingers[j].predictedX, hand.fingers[j].predictedY);
+				}
+				printf(", %.2f ms since capture\n", (now - frame.captured) / 1000.);
+			}
+		} else {
+			usleep(100);
+		}
+		if(now - lastReport > 1000000) {
+			if(frames > 0) {
+				printf("%u frames, %u missed, %.1f us to read, %.1f us after publishing\n",
+					frames, missed, (double) totalRead / frames, (double) totalAge / frames);
+			}
+			frames = missed = 0;
+			totalAge = totalRead = 0;
+			lastReport = now;
+		}
+	}
+	return 0;
+}
@@ -9,12 +9,17 @@ SineWave sine;
 
 PFont font;
 
+// HandOSC sends /hand/frame with a sequence number when bundling is enabled
+int lastFrame = -1;
+int droppedFrames = 0;
+
 void setup() {
   size(512, 200);
   frameRate(30);
   oscP5 = new OscP5(this, 8000);
   oscP5.plug(this, "handSize", "/hand/size");
   oscP5.plug(this, "handPosition", "/hand/position");
+  oscP5.plug(this, "handFrame", "/hand/frame");
   
   
   minim = new Minim(this);
@@ -33,6 +38,8 @@ void draw() {
     line(x1, 50 + out.left.get(i)*50, x2, 50 + out.left.get(i+1)*50);
     line(x1, 150 + out.right.get(i)*50, x2, 150 + out.right.get(i+1)*50);
   }
+  fill(0);
+  text("dropped " + droppedFrames, 10, height - 10);
 }
 
 public void handSize(float x) {
@@ -45,6 +52,13 @@ public void handPosition(float x, float y) {
   sine.setPan(pan);
 }
 
+public void handFrame(int frame) {
+  if (lastFrame >= 0 && frame > lastFrame + 1) {
+    droppedFrames += frame - lastFrame - 1;
+  }
+  lastFrame = frame;
+}
+
 // all other OSC messages end up here
 void oscEvent(OscMessage m) {
   if (m.isPlugged() == false) {
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "ofMain.h"
+
+inline float RandomGaussian(float mean, float stddev) {
+  float r1=ofRandom(1), r2=ofRandom(1);
+  float val = sqrtf(-2 * logf(r1)) * cos(TWO_PI * r2);
+  val = stddev * val + mean;
+  return val;
+}
+
+// xorshift128, so every thread can have its own generator instead of
+// sharing the global state behind ofRandom()
+class PoseRandom {
+public:
+	PoseRandom(unsigned int seed = 1) {
+		setSeed(seed);
+	}
+	void setSeed(unsigned int seed) {
+		x = 123456789 ^ seed;
+		y = 362436069;
+		z = 521288629;
+		w = 88675123 + seed * 2654435761u;
+		for(int i = 0; i < 16; i++) {
+			next();
+		}
+	}
+	unsigned int next() {
+		unsigned int t = x ^ (x << 11);
+		x = y;
+		y = z;
+		z = w;
+		w = w ^ (w >> 19) ^ t ^ (t >> 8);
+		return w;
+	}
+	// in (0, 1]
+	float uniform() {
+		return (next() >> 8) * (1. / (1 << 24)) + (1. / (1 << 24));
+	}
+	float gaussian(float mean, float stddev) {
+		float r1 = uniform(), r2 = uniform();
+		float val = sqrtf(-2 * logf(r1)) * cos(TWO_PI * r2);
+		return stddev * val + mean;
+	}
+protected:
+	unsigned int x, y, z, w;
+};
+
+class HandPose {
+private:
+	vector<string> names;
+	vector<float> minValues, maxValues, values;
+	void addDof(string name, float min, float max) {
+		names.push_back(name);
+		minValues.push_back(min);
+		maxValues.push_back(max);
+		values.push_back(0);
+	}
+public:
+	HandPose() {
+		// thumb
+		addDof("Finger-1-1_R.x", -40, 40);
+		addDof("Finger-1-1_R.y", -28, 16);
+		addDof("Finger-1-1_R.z", -2, 10);
+		addDof("Finger-1-2_R.y", -8, 10);
+		addDof("Finger-1-3_R.y", -20, 20);
+		
+		// fingers
+		for(int i = 2; i <= 5; i++) {
+			addDof("Finger-" + ofToString(i) + "-1_R.y", -15, 10);
+			addDof("Finger-" + ofToString(i) + "-1_R.z", -60, 30);
+			addDof("Finger-" + ofToString(i) + "-2_R.z", -90, 5);
+			addDof("Finger-" + ofToString(i) + "-3_R.z", -90, 5);
+		}
+	}
+	int size() {
+		return names.size();
+	}
+	string getName(int i) {
+		return names[i];
+	}
+	float& getMin(int i) {
+		return minValues[i];
+	}
+	float& getMax(int i) {
+		return maxValues[i];
+	}
+	float& getValue(int i) {
+		return values[i];
+	}
+	void save(string filename) {
+		ofFile file(filename, ofFile::WriteOnly);
+		for(int i = 0; i < size(); i++) {
+			file << getValue(i) << endl;
+		}
+	}
+	void load(string filename) {
+		ofFile file(filename, ofFile::ReadOnly);
+		for(int i = 0; i < size(); i++) {
+			file >> getValue(i);
+		}
+	}
+	void randomDeviation(float stddev) {
+		for(int i = 0; i < size(); i++) {
+			float range = maxValues[i] - minValues[i];
+			float curWidth = range * stddev;
+			values[i] = ofClamp(RandomGaussian(values[i], curWidth), minValues[i], maxValues[i]);
+		}
+	}
+	// a deviation for every dof, in the same order
+	void randomDeviation(const vector<float>& stddev) {
+		for(int i = 0; i < size(); i++) {
+			float range = maxValues[i] - minValues[i];
+			float curWidth = range * stddev[i];
+			values[i] = ofClamp(RandomGaussian(values[i], curWidth), minValues[i], maxValues[i]);
+		}
+	}
+	// the same with a generator that belongs to the caller
+	void randomDeviation(const vector<float>& stddev, PoseRandom& random) {
+		for(int i = 0; i < size(); i++) {
+			float range = maxValues[i] - minValues[i];
+			float curWidth = range * stddev[i];
+			values[i] = ofClamp(random.gaussian(values[i], curWidth), minValues[i], maxValues[i]);
+		}
+	}
+	// every value in dof order, for RiggedModel::setHandPose()
+	const float* getValues() {
+		return &values[0];
+	}
+};
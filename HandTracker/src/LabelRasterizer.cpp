@@ -0,0 +1,245 @@
+#include "LabelRasterizer.h"
+#include "Poco/Environment.h"
+
+static const int tileSize = 32;
+static const int subpixelBits = 8;
+static const int subpixel = 1 << subpixelBits;
+static const float depthRange = 1000;
+// keeps fixed point coordinates well inside 64 bit edge functions
+static const float maxCoordinate = 1 << 16;
+
+// waits to be started, fills tiles until there are none left, and says so
+class RasterWorker : public ofThread {
+public:
+	RasterWorker(LabelRasterizer& rasterizer, Poco::Semaphore& start, Poco::Semaphore& done)
+	:rasterizer(rasterizer)
+	,start(start)
+	,done(done) {
+	}
+	void threadedFunction() {
+		while(true) {
+			start.wait();
+			if(!isThreadRunning()) {
+				break;
+			}
+			rasterizer.drawTiles();
+			done.set();
+		}
+	}
+protected:
+	LabelRasterizer& rasterizer;
+	Poco::Semaphore &start, &done;
+};
+
+LabelRasterizer::LabelRasterizer()
+:width(0)
+,height(0)
+,tilesX(0)
+,tilesY(0)
+,start(0, 1024)
+,done(0, 1024)
+,nextTile(0) {
+}
+
+LabelRasterizer::~LabelRasterizer() {
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->stopThread();
+	}
+	for(int i = 0; i < workers.size(); i++) {
+		start.set();
+	}
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->waitForThread(false);
+		delete workers[i];
+	}
+}
+
+void LabelRasterizer::setup(int width, int height, int threads) {
+	this->width = width;
+	this->height = height;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	bins.resize(tilesX * tilesY);
+	depth.resize(width * height);
+	pixels.allocate(width, height, OF_IMAGE_GRAYSCALE);
+	pixels.set(0);
+	
+	if(threads < 1) {
+		threads = Poco::Environment::processorCount();
+	}
+	// the calling thread fills tiles too
+	threads = MIN(threads, tilesX * tilesY);
+	while(workers.size() < threads - 1) {
+		workers.push_back(new RasterWorker(*this, start, done));
+		workers.back()->startThread(true, false);
+	}
+}
+
+ofPixels& LabelRasterizer::getPixels() {
+	return pixels;
+}
+
+void LabelRasterizer::draw(const ofMesh& mesh, const ofMatrix4x4& transform) {
+	setupTriangles(mesh, transform);
+	nextTile = 0;
+	__sync_synchronize();
+	for(int i = 0; i < workers.size(); i++) {
+		start.set();
+	}
+	drawTiles();
+	for(int i = 0; i < workers.size(); i++) {
+		done.wait();
+	}
+}
+
+void LabelRasterizer::drawTiles() {
+	int tileCount = tilesX * tilesY;
+	int tile;
+	while((tile = __sync_fetch_and_add(&nextTile, 1)) < tileCount) {
+		drawTile(tile);
+	}
+}
+
+static long long toFixed(float x) {
+	return (long long) floorf(ofClamp(x, -maxCoordinate, maxCoordinate) * subpixel + .5);
+}
+
+// the first pixel whose center is at or after x, in fixed point
+static int firstPixel(long long x) {
+	return (int) ceil((x - subpixel / 2) / (double) subpixel);
+}
+
+// projects every vertex, sets up each triangle and sorts them into the tiles
+// they touch
+void LabelRasterizer::setupTriangles(const ofMesh& mesh, const ofMatrix4x4& transform) {
+	const vector<ofVec3f>& vertices = mesh.getVertices();
+	const vector<ofFloatColor>& colors = mesh.getColors();
+	const vector<ofIndexType>& indices = mesh.getIndices();
+	projected.resize(vertices.size());
+	for(int i = 0; i < vertices.size(); i++) {
+		projected[i] = transform.preMult(vertices[i]);
+	}
+	
+	for(int i = 0; i < bins.size(); i++) {
+		bins[i].clear();
+	}
+	triangles.clear();
+	int n = indices.empty() ? vertices.size() : indices.size();
+	for(int i = 0; i + 2 < n; i += 3) {
+		int index[3];
+		for(int j = 0; j < 3; j++) {
+			index[j] = indices.empty() ? i + j : indices[i + j];
+		}
+		Triangle triangle;
+		// flat shading takes the color of the last vertex
+		triangle.label = colors.empty() ? 255 : (unsigned char) (colors[index[2]].r * 255 + .5);
+		for(int j = 0; j < 3; j++) {
+			triangle.x[j] = toFixed(projected[index[j]].x);
+			triangle.y[j] = toFixed(projected[index[j]].y);
+		}
+		long long area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+			(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+		if(area == 0) {
+			continue;
+		}
+		if(area < 0) {
+			swap(index[1], index[2]);
+			swap(triangle.x[1], triangle.x[2]);
+			swap(triangle.y[1], triangle.y[2]);
+			area = -area;
+		}
+		
+		// depth is a plane through the three vertices
+		const ofVec3f& a = projected[index[0]];
+		const ofVec3f& b = projected[index[1]];
+		const ofVec3f& c = projected[index[2]];
+		float scale = (float) subpixel * subpixel / area;
+		float bx = (triangle.x[1] - triangle.x[0]) / (float) subpixel, by = (triangle.y[1] - triangle.y[0]) / (float) subpixel;
+		float cx = (triangle.x[2] - triangle.x[0]) / (float) subpixel, cy = (triangle.y[2] - triangle.y[0]) / (float) subpixel;
+		float bz = b.z - a.z, cz = c.z - a.z;
+		triangle.z = a.z;
+		triangle.dzdx = (bz * cy - cz * by) * scale;
+		triangle.dzdy = (cz * bx - bz * cx) * scale;
+		
+		long long minX = MIN(triangle.x[0], MIN(triangle.x[1], triangle.x[2]));
+		long long maxX = MAX(triangle.x[0], MAX(triangle.x[1], triangle.x[2]));
+		long long minY = MIN(triangle.y[0], MIN(triangle.y[1], triangle.y[2]));
+		long long maxY = MAX(triangle.y[0], MAX(triangle.y[1], triangle.y[2]));
+		triangle.left = MAX(firstPixel(minX), 0);
+		triangle.right = MIN(firstPixel(maxX + 1) - 1, width - 1);
+		triangle.bottom = MAX(firstPixel(minY), 0);
+		triangle.top = MIN(firstPixel(maxY + 1) - 1, height - 1);
+		if(triangle.left > triangle.right || triangle.bottom > triangle.top) {
+			continue;
+		}
+		
+		int k = triangles.size();
+		triangles.push_back(triangle);
+		for(int ty = triangle.bottom / tileSize; ty <= triangle.top / tileSize; ty++) {
+			for(int tx = triangle.left / tileSize; tx <= triangle.right / tileSize; tx++) {
+				bins[ty * tilesX + tx].push_back(k);
+			}
+		}
+	}
+}
+
+void LabelRasterizer::drawTile(int tile) {
+	int left = (tile % tilesX) * tileSize, bottom = (tile / tilesX) * tileSize;
+	int right = MIN(left + tileSize, width) - 1, top = MIN(bottom + tileSize, height) - 1;
+	unsigned char* labels = pixels.getPixels();
+	for(int y = bottom; y <= top; y++) {
+		memset(labels + y * width + left, 0, right - left + 1);
+		fill(depth.begin() + y * width + left, depth.begin() + y * width + right + 1, -depthRange);
+	}
+	const vector<int>& bin = bins[tile];
+	for(int i = 0; i < bin.size(); i++) {
+		const Triangle& triangle = triangles[bin[i]];
+		drawTriangle(triangle,
+			MAX(left, triangle.left), MAX(bottom, triangle.bottom),
+			MIN(right, triangle.right), MIN(top, triangle.top));
+	}
+}
+
+// fills the pixels in the given bounds whose centers are inside the
+// triangle. centers exactly on an edge belong to the triangle only for
+// top and left edges, so triangles sharing an edge never both draw it.
+void LabelRasterizer::drawTriangle(const Triangle& triangle, int left, int bottom, int right, int top) {
+	long long px = (long long) left * subpixel + subpixel / 2;
+	long long py = (long long) bottom * subpixel + subpixel / 2;
+	long long rowEdge[3], stepX[3], stepY[3];
+	for(int j = 0; j < 3; j++) {
+		int k = (j + 1) % 3;
+		long long dx = triangle.x[k] - triangle.x[j], dy = triangle.y[k] - triangle.y[j];
+		// positive on the inside of a counterclockwise edge
+		rowEdge[j] = dx * (py - triangle.y[j]) - dy * (px - triangle.x[j]);
+		bool topLeft = dy < 0 || (dy == 0 && dx < 0);
+		if(!topLeft) {
+			rowEdge[j]--;
+		}
+		stepX[j] = -dy * subpixel;
+		stepY[j] = dx * subpixel;
+	}
+	float rowZ = triangle.z +
+		triangle.dzdx * ((px - triangle.x[0]) / (float) subpixel) +
+		triangle.dzdy * ((py - triangle.y[0]) / (float) subpixel);
+	unsigned char* labels = pixels.getPixels();
+	for(int y = bottom; y <= top; y++) {
+		long long e0 = rowEdge[0], e1 = rowEdge[1], e2 = rowEdge[2];
+		float z = rowZ;
+		int i = y * width + left;
+		for(int x = left; x <= right; x++, i++) {
+			if((e0 | e1 | e2) >= 0 && z > depth[i] && z <= depthRange) {
+				depth[i] = z;
+				labels[i] = triangle.label;
+			}
+			e0 += stepX[0];
+			e1 += stepX[1];
+			e2 += stepX[2];
+			z += triangle.dzdx;
+		}
+		for(int j = 0; j < 3; j++) {
+			rowEdge[j] += stepY[j];
+		}
+		rowZ += triangle.dzdy;
+	}
+}
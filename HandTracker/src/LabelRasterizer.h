@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Semaphore.h"
+
+// draws a mesh into a label image on the cpu, the same way the fbo does with
+// depth testing and flat shading: every triangle is filled with the color of
+// its last vertex wherever it's closer than what was drawn before. the image
+// is split into tiles that are filled in parallel, and each tile draws its
+// triangles in mesh order, so the result doesn't depend on the threads.
+class LabelRasterizer {
+public:
+	LabelRasterizer();
+	~LabelRasterizer();
+	
+	// threads 0 means one per core
+	void setup(int width, int height, int threads = 0);
+	// transform takes the mesh to pixels like the modelview on top of
+	// ofSetupScreenOrtho(width, height, OF_ORIENTATION_DEFAULT, false, -1000, 1000):
+	// y up and larger z closer, anything beyond 1000 either way is clipped
+	void draw(const ofMesh& mesh, const ofMatrix4x4& transform);
+	// one byte per pixel, 0 where nothing was drawn, starting from the bottom
+	// row like fbo.readToPixels()
+	ofPixels& getPixels();
+	
+	// fills tiles until there are none left, called by every thread
+	void drawTiles();
+	
+protected:
+	class Triangle {
+	public:
+		// 24.8 fixed point pixel coordinates, counterclockwise
+		long long x[3], y[3];
+		// depth at the first vertex and its change per pixel
+		float z, dzdx, dzdy;
+		int left, bottom, right, top;
+		unsigned char label;
+	};
+	
+	void setupTriangles(const ofMesh& mesh, const ofMatrix4x4& transform);
+	void drawTile(int tile);
+	void drawTriangle(const Triangle& triangle, int left, int bottom, int right, int top);
+	
+	int width, height;
+	int tilesX, tilesY;
+	vector<ofVec3f> projected;
+	vector<Triangle> triangles;
+	// the triangles touching each tile, in mesh order
+	vector< vector<int> > bins;
+	vector<float> depth;
+	ofPixels pixels;
+	
+	vector<ofThread*> workers;
+	Poco::Semaphore start, done;
+	volatile int nextTile;
+};
@@ -0,0 +1,197 @@
+#include "PoseLibrary.h"
+#include "RiggedModel.h"
+#include "LabelRasterizer.h"
+#include "SilhouetteScorer.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static const char libraryMagic[4] = {'H', 'P', 'L', 'B'};
+static const uint32_t libraryVersion = 1;
+static const int coarseSide = 8, fineSide = 32;
+static const int fineWords = fineSide * fineSide / 64;
+// the coarse pass keeps this many poses for every one asked for
+static const int shortlistRatio = 64;
+
+// the coarse and fine descriptors of a label image
+static void describe(const ofPixels& labels, uint64_t& coarse, uint64_t* fine) {
+	ofPixels resized;
+	resizeMask(labels, resized, coarseSide, coarseSide);
+	packMask(resized.getPixels(), coarseSide * coarseSide, &coarse);
+	resizeMask(labels, resized, fineSide, fineSide);
+	packMask(resized.getPixels(), fineSide * fineSide, fine);
+}
+
+PoseLibrary::PoseLibrary()
+:data(NULL)
+,length(0)
+,header(NULL)
+,coarse(NULL)
+,fine(NULL)
+,values(NULL) {
+}
+
+PoseLibrary::~PoseLibrary() {
+	close();
+}
+
+bool PoseLibrary::open(string path) {
+	close();
+	int fd = ::open(ofToDataPath(path).c_str(), O_RDONLY);
+	if(fd < 0) {
+		ofLogError() << "couldn't open pose library " << path;
+		return false;
+	}
+	struct stat info;
+	if(fstat(fd, &info) < 0 || info.st_size < (off_t) sizeof(PoseLibraryHeader)) {
+		ofLogError() << path << " is too short to be a pose library";
+		::close(fd);
+		return false;
+	}
+	void* memory = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		ofLogError() << "couldn't map pose library " << path;
+		return false;
+	}
+	data = (unsigned char*) memory;
+	length = info.st_size;
+	header = (const PoseLibraryHeader*) data;
+	HandPose pose;
+	if(memcmp(header->magic, libraryMagic, sizeof(header->magic)) != 0 || header->version != libraryVersion ||
+		header->coarseSide != coarseSide || header->fineSide != fineSide || header->dofs != pose.size()) {
+		ofLogError() << path << " is not a pose library for this HandPose";
+		close();
+		return false;
+	}
+	uint64_t expected = sizeof(PoseLibraryHeader) +
+		(uint64_t) header->count * (sizeof(uint64_t) * (1 + fineWords) + sizeof(float) * header->dofs);
+	if(expected > length) {
+		ofLogError() << path << " is cut short";
+		close();
+		return false;
+	}
+	coarse = (const uint64_t*) (header + 1);
+	fine = coarse + header->count;
+	values = (const float*) (fine + header->count * fineWords);
+	return true;
+}
+
+void PoseLibrary::close() {
+	if(data != NULL) {
+		munmap(data, length);
+	}
+	data = NULL;
+	length = 0;
+	header = NULL;
+	coarse = NULL;
+	fine = NULL;
+	values = NULL;
+}
+
+bool PoseLibrary::isOpen() const {
+	return header != NULL;
+}
+
+int PoseLibrary::size() const {
+	return header == NULL ? 0 : header->count;
+}
+
+void PoseLibrary::search(const ofPixels& reference, int k, vector<PoseMatch>& matches) {
+	matches.clear();
+	int n = size();
+	k = MIN(k, n);
+	if(k == 0) {
+		return;
+	}
+	uint64_t referenceCoarse, referenceFine[fineWords];
+	describe(reference, referenceCoarse, referenceFine);
+
+	shortlist.resize(n);
+	for(int i = 0; i < n; i++) {
+		shortlist[i] = pair<int, int>(__builtin_popcountll(coarse[i] ^ referenceCoarse), i);
+	}
+	int shortlisted = MIN(k * shortlistRatio, n);
+	nth_element(shortlist.begin(), shortlist.begin() + shortlisted - 1, shortlist.end());
+
+	matches.resize(shortlisted);
+	for(int i = 0; i < shortlisted; i++) {
+		int index = shortlist[i].second;
+		const uint64_t* cur = fine + index * fineWords;
+		int distance = 0;
+		for(int j = 0; j < fineWords; j++) {
+			distance += __builtin_popcountll(cur[j] ^ referenceFine[j]);
+		}
+		matches[i].index = index;
+		matches[i].distance = distance;
+	}
+	partial_sort(matches.begin(), matches.begin() + k, matches.end());
+	matches.resize(k);
+}
+
+void PoseLibrary::getPose(int index, HandPose& pose) const {
+	const float* cur = values + index * header->dofs;
+	for(int i = 0; i < pose.size(); i++) {
+		pose.getValue(i) = cur[i];
+	}
+}
+
+bool buildPoseLibrary(string modelPath, string path, int count, int drawnSide, unsigned int seed) {
+	if(count < 1) {
+		ofLogError() << "a pose library needs at least one pose";
+		return false;
+	}
+	RiggedModel model;
+	if(!model.loadModel(modelPath)) {
+		return false;
+	}
+	HandPose pose;
+	model.compileHandPose(pose);
+	LabelRasterizer rasterizer;
+	rasterizer.setup(drawnSide, drawnSide);
+	PoseRandom random(seed);
+
+	int dofs = pose.size();
+	vector<uint64_t> coarse(count), fine(count * fineWords);
+	vector<float> values(count * dofs);
+	float start = ofGetElapsedTimef();
+	for(int i = 0; i < count; i++) {
+		for(int j = 0; j < dofs; j++) {
+			pose.getValue(j) = ofLerp(pose.getMin(j), pose.getMax(j), random.uniform());
+			values[i * dofs + j] = pose.getValue(j);
+		}
+		model.setHandPose(pose.getValues(), 0, false);
+		rasterizer.draw(model.maskedModel, model.getLabelTransform(drawnSide, drawnSide));
+		describe(rasterizer.getPixels(), coarse[i], &fine[i * fineWords]);
+		if((i + 1) % 10000 == 0) {
+			cout << (i + 1) << " poses after " << (ofGetElapsedTimef() - start) << "s" << endl;
+		}
+	}
+
+	PoseLibraryHeader header;
+	memcpy(header.magic, libraryMagic, sizeof(header.magic));
+	header.version = libraryVersion;
+	header.count = count;
+	header.dofs = dofs;
+	header.coarseSide = coarseSide;
+	header.fineSide = fineSide;
+	header.fineWords = fineWords;
+	header.drawnSide = drawnSide;
+	FILE* file = fopen(ofToDataPath(path).c_str(), "wb");
+	if(file == NULL) {
+		ofLogError() << "couldn't write pose library " << path;
+		return false;
+	}
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(&coarse[0], sizeof(uint64_t), coarse.size(), file) == coarse.size() &&
+		fwrite(&fine[0], sizeof(uint64_t), fine.size(), file) == fine.size() &&
+		fwrite(&values[0], sizeof(float), values.size(), file) == values.size();
+	fclose(file);
+	if(!written) {
+		ofLogError() << "couldn't write pose library " << path;
+		return false;
+	}
+	cout << "wrote " << count << " poses to " << path << " in " << (ofGetElapsedTimef() - start) << "s" << endl;
+	return true;
+}
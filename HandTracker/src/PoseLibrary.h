@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ofMain.h"
+#include "HandPose.h"
+
+// a library of random poses and their silhouettes, to start fitting from
+// the poses that already look most like the reference. the file is:
+//
+//	PoseLibraryHeader
+//	a coarse descriptor for every pose, one 64 bit word
+//	a fine descriptor for every pose, fineWords words
+//	the values of every pose, dofs floats
+//
+// descriptors are the silhouette scaled down to 8x8 and 32x32 bits, framed
+// like testApp draws the labels. a search compares the reference's coarse
+// descriptor to every pose, then only the closest shortlist by its fine
+// descriptor, both as the number of different bits.
+
+struct PoseLibraryHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t count;
+	uint32_t dofs;
+	uint32_t coarseSide, fineSide;
+	uint32_t fineWords;
+	// the size the silhouettes were drawn at before scaling down
+	uint32_t drawnSide;
+};
+
+// one pose found by PoseLibrary::search()
+class PoseMatch {
+public:
+	int index;
+	// different bits out of fineSide * fineSide
+	int distance;
+	bool operator<(const PoseMatch& other) const {
+		return distance < other.distance;
+	}
+};
+
+// memory maps a library built by buildPoseLibrary()
+class PoseLibrary {
+public:
+	PoseLibrary();
+	~PoseLibrary();
+
+	bool open(string path);
+	void close();
+	bool isOpen() const;
+
+	int size() const;
+	// the k poses whose silhouettes are closest to reference, closest first.
+	// reference is one byte per pixel with 0 for the background, framed like
+	// the labels testApp draws.
+	void search(const ofPixels& reference, int k, vector<PoseMatch>& matches);
+	void getPose(int index, HandPose& pose) const;
+
+protected:
+	unsigned char* data;
+	size_t length;
+	const PoseLibraryHeader* header;
+	const uint64_t* coarse;
+	const uint64_t* fine;
+	const float* values;
+	vector< pair<int, int> > shortlist;
+};
+
+// draws count uniformly random poses with a model loaded from modelPath at
+// drawnSide x drawnSide and writes their descriptors to path. loading the
+// model needs a GL context.
+bool buildPoseLibrary(string modelPath, string path, int count, int drawnSide = 128, unsigned int seed = 1);
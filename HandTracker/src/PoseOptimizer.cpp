@@ -0,0 +1,643 @@
+#include "PoseOptimizer.h"
+#include "Poco/Environment.h"
+
+// levels smaller than this can't tell fingers apart
+static const int minLevelSide = 32;
+
+PoseEvaluator::PoseEvaluator() {
+}
+
+PoseEvaluator::~PoseEvaluator() {
+	for(int i = 0; i < levels.size(); i++) {
+		delete levels[i];
+	}
+}
+
+bool PoseEvaluator::setup(string modelPath, const ofPixels& reference, unsigned int seed, int levelCount) {
+	if(!model.loadModel(modelPath)) {
+		return false;
+	}
+	HandPose handPose;
+	model.compileHandPose(handPose);
+	labelRating.assign(handPose.size(), 0);
+	
+	ofPixels levelReference = reference;
+	for(int i = 0; i < levelCount; i++) {
+		if(i > 0) {
+			int width = levelReference.getWidth(), height = levelReference.getHeight();
+			if(MIN(width, height) / 2 < minLevelSide) {
+				break;
+			}
+			ofPixels above = levelReference;
+			resizeMask(above, levelReference, width / 2, height / 2);
+		}
+		Level* level = new Level();
+		level->width = levelReference.getWidth();
+		level->height = levelReference.getHeight();
+		level->rasterizer.setup(level->width, level->height, 1);
+		level->scorer.setup(levelReference);
+		levels.push_back(level);
+	}
+	setCost(SILHOUETTE_MISMATCH);
+	scored.assign(levels.size(), 0);
+	random.setSeed(seed);
+	return true;
+}
+
+void PoseEvaluator::setCost(SilhouetteCost cost) {
+	// mismatches grow with the area, chamfer distances also with the side
+	int power = cost == SILHOUETTE_CHAMFER ? 3 : 2;
+	for(int i = 0; i < levels.size(); i++) {
+		levels[i]->scorer.setCost(cost);
+		levels[i]->scale = powf((float) levels[0]->width / levels[i]->width, power);
+	}
+}
+
+int PoseEvaluator::evaluate(HandPose& handPose, float bound) {
+	model.setHandPose(handPose.getValues(), 0, false);
+	int score = 0, level = levels.size() - 1;
+	for(; level >= 0; level--) {
+		Level& cur = *levels[level];
+		cur.rasterizer.draw(model.maskedModel, model.getLabelTransform(cur.width, cur.height));
+		score = cur.scorer.score(cur.rasterizer.getPixels());
+		scored[level]++;
+		if(level > 0 && score * cur.scale > bound) {
+			score = MIN(score * cur.scale, (float) INT_MAX - 128);
+			break;
+		}
+	}
+	
+	// the ratings are fractions, so any level will do
+	const SilhouetteScorer& scorer = levels[MAX(level, 0)]->scorer;
+	const vector<int>& labelDifference = scorer.getLabelDifference();
+	const vector<int>& labelTotal = scorer.getLabelTotal();
+	for(int i = 0; i < labelRating.size(); i++) {
+		int bone = model.getDofBone(i);
+		if(bone >= 0 && labelTotal[bone] > 0) {
+			labelRating[i] = (float) labelDifference[bone] / labelTotal[bone];
+		}
+	}
+	return score;
+}
+
+vector<float>& PoseEvaluator::getLabelRating() {
+	return labelRating;
+}
+
+PoseRandom& PoseEvaluator::getRandom() {
+	return random;
+}
+
+int PoseEvaluator::getLevels() {
+	return levels.size();
+}
+
+const vector<int>& PoseEvaluator::getScored() {
+	return scored;
+}
+
+void PoseEvaluator::getResiduals(vector<float>& residuals) {
+	levels[0]->scorer.getResiduals(residuals);
+}
+
+void PoseEvaluator::resetScored() {
+	scored.assign(levels.size(), 0);
+}
+
+// every pose is drawn at the smallest level, so that count is all the poses
+float PoseEvaluator::getDrawnFraction(const vector<int>& scored) {
+	int poses = scored.back();
+	if(poses == 0) {
+		return 0;
+	}
+	double drawn = 0;
+	for(int i = 0; i < levels.size(); i++) {
+		drawn += (double) scored[i] * levels[i]->width * levels[i]->height;
+	}
+	return drawn / ((double) poses * levels[0]->width * levels[0]->height);
+}
+
+// scores candidates until there are none left, and says so
+class PoseWorker : public ofThread {
+public:
+	PoseWorker(PoseOptimizer& optimizer, PoseEvaluator& evaluator, Poco::Semaphore& start, Poco::Semaphore& done)
+	:optimizer(optimizer)
+	,evaluator(evaluator)
+	,start(start)
+	,done(done) {
+	}
+	void threadedFunction() {
+		while(true) {
+			start.wait();
+			if(!isThreadRunning()) {
+				break;
+			}
+			optimizer.evaluateCandidates(evaluator);
+			done.set();
+		}
+	}
+protected:
+	PoseOptimizer& optimizer;
+	PoseEvaluator& evaluator;
+	Poco::Semaphore &start, &done;
+};
+
+// iterations without a better pose before the deviations are widened again
+static const int maxStalled = 10;
+// deviations as a fraction of each dof's range
+static const float deviationFloor = .002, deviationCeiling = .5, restartDeviation = .1;
+// candidates estimated at more than this times the best score at a coarse
+// level aren't drawn any larger
+static const float rejectRatio = 1.5;
+// refinement steps each dof by this fraction of its range for the jacobian
+static const float refinementStep = .02;
+// the dampings tried at once are the current one times these
+static const float dampingTrials[] = {.1, 1, 10, 100};
+static const int dampingTrialCount = sizeof(dampingTrials) / sizeof(dampingTrials[0]);
+static const float startDamping = .01, minDamping = 1e-4;
+
+PoseOptimizer::PoseOptimizer()
+:start(0, 1024)
+,done(0, 1024)
+,nextCandidate(0)
+,bound(FLT_MAX)
+,keepResiduals(false)
+,populationSize(0)
+,stalled(0)
+,cost(SILHOUETTE_MISMATCH)
+,refinement(true)
+,refining(false)
+,damping(startDamping)
+,bestScore(INT_MAX)
+,iterations(0)
+,evaluations(0)
+,refinements(0) {
+}
+
+PoseOptimizer::~PoseOptimizer() {
+	stop();
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->stopThread();
+	}
+	for(int i = 0; i < workers.size(); i++) {
+		start.set();
+	}
+	for(int i = 0; i < workers.size(); i++) {
+		workers[i]->waitForThread(false);
+		delete workers[i];
+	}
+	for(int i = 0; i < evaluators.size(); i++) {
+		delete evaluators[i];
+	}
+}
+
+bool PoseOptimizer::setup(string modelPath, const ofPixels& reference, int threads, int populationSize, int levels) {
+	if(threads < 1) {
+		threads = Poco::Environment::processorCount();
+	}
+	// models have to be loaded here, where there's a GL context
+	for(int i = 0; i < threads; i++) {
+		evaluators.push_back(new PoseEvaluator());
+		if(!evaluators.back()->setup(modelPath, reference, i + 1, levels)) {
+			for(int j = 0; j < evaluators.size(); j++) {
+				delete evaluators[j];
+			}
+			evaluators.clear();
+			return false;
+		}
+	}
+	// the optimizing thread scores candidates with the first evaluator
+	for(int i = 1; i < threads; i++) {
+		workers.push_back(new PoseWorker(*this, *evaluators[i], start, done));
+		workers.back()->startThread(true, false);
+	}
+	this->populationSize = populationSize;
+	
+	// the best quarter is weighted by rank like CMA-ES
+	int elite = MAX(populationSize / 4, 1);
+	weights.resize(elite);
+	float total = 0;
+	for(int i = 0; i < elite; i++) {
+		weights[i] = logf(elite + .5) - logf(i + 1);
+		total += weights[i];
+	}
+	for(int i = 0; i < elite; i++) {
+		weights[i] /= total;
+	}
+	return true;
+}
+
+bool PoseOptimizer::isSetup() {
+	return !evaluators.empty();
+}
+
+void PoseOptimizer::setCost(SilhouetteCost cost) {
+	this->cost = cost;
+	for(int i = 0; i < evaluators.size(); i++) {
+		evaluators[i]->setCost(cost);
+	}
+}
+
+void PoseOptimizer::setRefinement(bool refinement) {
+	this->refinement = refinement;
+}
+
+void PoseOptimizer::reset(HandPose& startPose, float startDeviation) {
+	int n = startPose.size();
+	mean.resize(n);
+	deviation.resize(n);
+	minDeviation.resize(n);
+	maxDeviation.resize(n);
+	for(int i = 0; i < n; i++) {
+		float range = startPose.getMax(i) - startPose.getMin(i);
+		mean[i] = startPose.getValue(i);
+		deviation[i] = startDeviation * range;
+		minDeviation[i] = deviationFloor * range;
+		maxDeviation[i] = deviationCeiling * range;
+	}
+	stalled = 0;
+	refining = false;
+	damping = startDamping;
+	for(int i = 0; i < evaluators.size(); i++) {
+		evaluators[i]->resetScored();
+	}
+	ofScopedLock lock(bestMutex);
+	best = startPose;
+	bestScore = INT_MAX;
+	iterations = 0;
+	evaluations = 0;
+	refinements = 0;
+}
+
+void PoseOptimizer::iterate() {
+	if(refining) {
+		refine();
+		return;
+	}
+	HandPose sample = best;
+	int n = mean.size();
+	candidates.resize(populationSize);
+	for(int k = 0; k < candidates.size(); k++) {
+		for(int i = 0; i < n; i++) {
+			sample.getValue(i) = ofClamp(random.gaussian(mean[i], deviation[i]), sample.getMin(i), sample.getMax(i));
+		}
+		candidates[k] = sample;
+	}
+	
+	scoreCandidates(false);
+	
+	order.resize(candidates.size());
+	for(int k = 0; k < candidates.size(); k++) {
+		order[k] = pair<int, int>(scores[k], k);
+	}
+	ofSort(order);
+	
+	// the deviations are measured around the old mean, so they grow while
+	// the mean is moving and shrink once it settles
+	for(int i = 0; i < n; i++) {
+		float nextMean = 0, variance = 0;
+		for(int j = 0; j < weights.size(); j++) {
+			float value = candidates[order[j].second].getValue(i);
+			nextMean += weights[j] * value;
+			variance += weights[j] * (value - mean[i]) * (value - mean[i]);
+		}
+		mean[i] = nextMean;
+		deviation[i] = ofClamp((deviation[i] + sqrtf(variance)) / 2, minDeviation[i], maxDeviation[i]);
+	}
+	
+	ofScopedLock lock(bestMutex);
+	if(order[0].first < bestScore) {
+		bestScore = order[0].first;
+		best = candidates[order[0].second];
+		stalled = 0;
+	} else if(++stalled == maxStalled) {
+		if(refinement && cost == SILHOUETTE_CHAMFER) {
+			refining = true;
+			damping = startDamping;
+		} else {
+			restart();
+		}
+		stalled = 0;
+	}
+	iterations++;
+	evaluations += candidates.size();
+}
+
+void PoseOptimizer::restart() {
+	for(int i = 0; i < mean.size(); i++) {
+		mean[i] = best.getValue(i);
+		deviation[i] = MAX(deviation[i], restartDeviation * (best.getMax(i) - best.getMin(i)));
+	}
+}
+
+// solves a x = b in place for a symmetric positive definite n x n a
+static bool solveCholesky(vector<double>& a, vector<double>& b, int n) {
+	for(int j = 0; j < n; j++) {
+		double sum = a[j * n + j];
+		for(int k = 0; k < j; k++) {
+			sum -= a[j * n + k] * a[j * n + k];
+		}
+		if(sum <= 0) {
+			return false;
+		}
+		a[j * n + j] = sqrt(sum);
+		for(int i = j + 1; i < n; i++) {
+			double cur = a[i * n + j];
+			for(int k = 0; k < j; k++) {
+				cur -= a[i * n + k] * a[j * n + k];
+			}
+			a[i * n + j] = cur / a[j * n + j];
+		}
+	}
+	for(int i = 0; i < n; i++) {
+		double cur = b[i];
+		for(int k = 0; k < i; k++) {
+			cur -= a[i * n + k] * b[k];
+		}
+		b[i] = cur / a[i * n + i];
+	}
+	for(int i = n - 1; i >= 0; i--) {
+		double cur = b[i];
+		for(int k = i + 1; k < n; k++) {
+			cur -= a[k * n + i] * b[k];
+		}
+		b[i] = cur / a[i * n + i];
+	}
+	return true;
+}
+
+// one levenberg-marquardt step from the best pose
+void PoseOptimizer::refine() {
+	// the best pose, and a step along every dof away from its nearer limit
+	int n = best.size();
+	candidates.assign(n + 1, best);
+	steps.resize(n);
+	for(int i = 0; i < n; i++) {
+		float step = refinementStep * (best.getMax(i) - best.getMin(i));
+		if(best.getValue(i) + step > best.getMax(i)) {
+			step = -step;
+		}
+		candidates[i + 1].getValue(i) += step;
+		steps[i] = step;
+	}
+	scoreCandidates(true);
+	
+	// only pixels that differ from the reference in some candidate count
+	const vector<float>& base = residuals[0];
+	active.clear();
+	for(int p = 0; p < base.size(); p++) {
+		bool differs = base[p] != 0;
+		for(int i = 1; !differs && i <= n; i++) {
+			differs = residuals[i][p] != 0;
+		}
+		if(differs) {
+			active.push_back(p);
+		}
+	}
+	
+	// the gauss-newton approximation of the hessian, and the gradient
+	hessian.assign(n * n, 0);
+	gradient.assign(n, 0);
+	vector<double> column(n);
+	for(int a = 0; a < active.size(); a++) {
+		int p = active[a];
+		for(int i = 0; i < n; i++) {
+			column[i] = (residuals[i + 1][p] - base[p]) / steps[i];
+			gradient[i] += column[i] * base[p];
+			for(int j = 0; j <= i; j++) {
+				hessian[i * n + j] += column[i] * column[j];
+			}
+		}
+	}
+	double trace = 0;
+	for(int i = 0; i < n; i++) {
+		for(int j = 0; j < i; j++) {
+			hessian[j * n + i] = hessian[i * n + j];
+		}
+		trace += hessian[i * n + i];
+	}
+	
+	// dofs that don't change any pixel get a tiny diagonal so the system
+	// can still be solved, and don't move
+	double epsilon = 1e-6 * trace / n + 1e-12;
+	candidates.assign(dampingTrialCount, best);
+	vector<double> system, delta;
+	for(int t = 0; t < dampingTrialCount; t++) {
+		system = hessian;
+		delta.resize(n);
+		for(int i = 0; i < n; i++) {
+			system[i * n + i] += damping * dampingTrials[t] * system[i * n + i] + epsilon;
+			delta[i] = -gradient[i];
+		}
+		if(solveCholesky(system, delta, n)) {
+			HandPose& trial = candidates[t];
+			for(int i = 0; i < n; i++) {
+				trial.getValue(i) = ofClamp(trial.getValue(i) + delta[i], trial.getMin(i), trial.getMax(i));
+			}
+		}
+	}
+	scoreCandidates(false);
+	int bestTrial = min_element(scores.begin(), scores.end()) - scores.begin();
+	
+	ofScopedLock lock(bestMutex);
+	if(scores[bestTrial] < bestScore) {
+		bestScore = scores[bestTrial];
+		best = candidates[bestTrial];
+		damping = MAX(damping * dampingTrials[bestTrial] / 10, minDamping);
+	} else {
+		// no damping helps, so it's back to the population
+		refining = false;
+		restart();
+	}
+	iterations++;
+	refinements++;
+	evaluations += n + 1 + dampingTrialCount;
+}
+
+void PoseOptimizer::scoreCandidates(bool residuals) {
+	keepResiduals = residuals;
+	if(residuals) {
+		this->residuals.resize(candidates.size());
+	}
+	scores.resize(candidates.size());
+	nextCandidate = 0;
+	bound = residuals || bestScore == INT_MAX ? FLT_MAX : rejectRatio * bestScore;
+	__sync_synchronize();
+	for(int i = 0; i < workers.size(); i++) {
+		start.set();
+	}
+	evaluateCandidates(*evaluators[0]);
+	for(int i = 0; i < workers.size(); i++) {
+		done.wait();
+	}
+}
+
+void PoseOptimizer::evaluateCandidates(PoseEvaluator& evaluator) {
+	int k;
+	while((k = __sync_fetch_and_add(&nextCandidate, 1)) < candidates.size()) {
+		scores[k] = evaluator.evaluate(candidates[k], bound);
+		if(keepResiduals) {
+			evaluator.getResiduals(residuals[k]);
+		}
+	}
+}
+
+void PoseOptimizer::threadedFunction() {
+	while(isThreadRunning()) {
+		iterate();
+	}
+}
+
+void PoseOptimizer::stop() {
+	if(isThreadRunning()) {
+		waitForThread(true);
+	}
+}
+
+int PoseOptimizer::getBest(HandPose& pose) {
+	ofScopedLock lock(bestMutex);
+	pose = best;
+	return bestScore;
+}
+
+int PoseOptimizer::getIterations() {
+	ofScopedLock lock(bestMutex);
+	return iterations;
+}
+
+int PoseOptimizer::getEvaluations() {
+	ofScopedLock lock(bestMutex);
+	return evaluations;
+}
+
+int PoseOptimizer::getRefinements() {
+	ofScopedLock lock(bestMutex);
+	return refinements;
+}
+
+vector<int> PoseOptimizer::getScored() {
+	vector<int> scored(evaluators[0]->getLevels(), 0);
+	for(int i = 0; i < evaluators.size(); i++) {
+		for(int j = 0; j < scored.size(); j++) {
+			scored[j] += evaluators[i]->getScored()[j];
+		}
+	}
+	return scored;
+}
+
+int getLevelCount(int width, int height) {
+	int levels = 1;
+	while(MIN(width, height) / 2 >= minLevelSide) {
+		width /= 2;
+		height /= 2;
+		levels++;
+	}
+	return levels;
+}
+
+float PoseOptimizer::getDrawnFraction() {
+	return evaluators[0]->getDrawnFraction(getScored());
+}
+
+// seconds from the start until the score was at most target, -1 if never
+static float getTimeToReach(const vector< pair<float, int> >& improvements, int target) {
+	for(int i = 0; i < improvements.size(); i++) {
+		if(improvements[i].second <= target) {
+			return improvements[i].first;
+		}
+	}
+	return -1;
+}
+
+static void printResult(string name, const vector< pair<float, int> >& improvements, int evaluations, float seconds, int target, int pixels) {
+	int best = improvements.empty() ? INT_MAX : improvements.back().second;
+	float stopped = improvements.empty() ? 0 : improvements.back().first;
+	cout << name << ": " << evaluations << " poses, " << (evaluations / seconds) << " poses/s, best "
+		<< best << " (" << (100. * best / pixels) << "%), stopped improving after " << stopped << "s";
+	float reached = getTimeToReach(improvements, target);
+	if(reached < 0) {
+		cout << ", never reached the random search's best" << endl;
+	} else {
+		cout << ", reached the random search's best after " << reached << "s" << endl;
+	}
+}
+
+// runs optimizer from start for seconds, noting every time its best improved
+static void runPopulation(PoseOptimizer& optimizer, HandPose start, float seconds, vector< pair<float, int> >& improvements) {
+	optimizer.reset(start);
+	HandPose pose;
+	int bestScore = INT_MAX;
+	float begin = ofGetElapsedTimef(), now = begin;
+	while(now - begin < seconds) {
+		optimizer.iterate();
+		int score = optimizer.getBest(pose);
+		now = ofGetElapsedTimef();
+		if(score < bestScore) {
+			bestScore = score;
+			improvements.push_back(pair<float, int>(now - begin, score));
+		}
+	}
+}
+
+void compareOptimizers(string modelPath, const ofPixels& reference, HandPose start, float seconds, int threads, int levels, SilhouetteCost cost) {
+	int pixels = reference.getWidth() * reference.getHeight();
+	
+	// the same steps as testApp::randomPose(), one pose at a time
+	PoseEvaluator evaluator;
+	if(!evaluator.setup(modelPath, reference, 1)) {
+		return;
+	}
+	evaluator.setCost(cost);
+	vector< pair<float, int> > hillImprovements;
+	HandPose pose = start, bestPose = start;
+	int bestScore = INT_MAX, iterations = 0, hillEvaluations = 0;
+	float begin = ofGetElapsedTimef(), now = begin;
+	while(now - begin < seconds) {
+		if(iterations > 100) {
+			pose = bestPose;
+			iterations = 0;
+		} else {
+			pose.randomDeviation(evaluator.getLabelRating(), evaluator.getRandom());
+			iterations++;
+		}
+		int score = evaluator.evaluate(pose);
+		hillEvaluations++;
+		now = ofGetElapsedTimef();
+		if(score < bestScore) {
+			bestScore = score;
+			bestPose = pose;
+			hillImprovements.push_back(pair<float, int>(now - begin, score));
+		}
+	}
+	
+	PoseOptimizer optimizer;
+	if(!optimizer.setup(modelPath, reference, threads, 64, levels)) {
+		return;
+	}
+	optimizer.setCost(cost);
+	vector< pair<float, int> > populationImprovements, refinedImprovements;
+	optimizer.setRefinement(false);
+	runPopulation(optimizer, start, seconds, populationImprovements);
+	int populationEvaluations = optimizer.getEvaluations();
+	vector<int> scored = optimizer.getScored();
+	float drawnFraction = optimizer.getDrawnFraction();
+	bool refining = cost == SILHOUETTE_CHAMFER;
+	if(refining) {
+		optimizer.setRefinement(true);
+		runPopulation(optimizer, start, seconds, refinedImprovements);
+	}
+	
+	printResult("hill climber", hillImprovements, hillEvaluations, seconds, bestScore, pixels);
+	printResult("population", populationImprovements, populationEvaluations, seconds, bestScore, pixels);
+	for(int i = scored.size() - 1; i > 0; i--) {
+		cout << (reference.getWidth() >> i) << "px: " << scored[i] << " poses, ";
+	}
+	cout << reference.getWidth() << "px: " << scored[0] << " poses, ";
+	cout << (int) (100 * drawnFraction) << "% of the full size pixels drawn per pose" << endl;
+	if(refining) {
+		printResult("population and refinement", refinedImprovements, optimizer.getEvaluations(), seconds, bestScore, pixels);
+		cout << optimizer.getRefinements() << " of " << optimizer.getIterations() << " iterations refined" << endl;
+	} else {
+		cout << "no refinement without the chamfer cost" << endl;
+	}
+}
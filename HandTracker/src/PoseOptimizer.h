@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ofMain.h"
+#include "Poco/Semaphore.h"
+#include "HandPose.h"
+#include "RiggedModel.h"
+#include "LabelRasterizer.h"
+#include "SilhouetteScorer.h"
+
+// scores poses against a reference silhouette on any thread. each evaluator
+// has its own copy of the model, rasterizer and random generator.
+//
+// with more than one level, the reference is also kept at half the size
+// for every extra level (not below 32 pixels), and poses are drawn and
+// scored from the smallest up. a pose stops at the first level where its
+// score, scaled up to the full size, is already above the bound it's given.
+class PoseEvaluator {
+public:
+	PoseEvaluator();
+	~PoseEvaluator();
+	
+	bool setup(string modelPath, const ofPixels& reference, unsigned int seed, int levels = 1);
+	void setCost(SilhouetteCost cost);
+	// draws the pose and scores it against the reference, like
+	// testApp::updateDifference(). a pose rejected early gets its estimate.
+	int evaluate(HandPose& pose, float bound = FLT_MAX);
+	// fraction of each bone's pixels outside the reference in the last
+	// evaluation, by dof
+	vector<float>& getLabelRating();
+	// SilhouetteScorer::getResiduals() at full size, for the last pose that
+	// was evaluated without a bound
+	void getResiduals(vector<float>& residuals);
+	PoseRandom& getRandom();
+	
+	int getLevels();
+	// how many poses were scored at each level, the first is full size
+	const vector<int>& getScored();
+	void resetScored();
+	// the pixels drawn per pose over all levels for counts like getScored(),
+	// as a fraction of drawing every pose once at full size
+	float getDrawnFraction(const vector<int>& scored);
+	
+protected:
+	class Level {
+	public:
+		LabelRasterizer rasterizer;
+		SilhouetteScorer scorer;
+		int width, height;
+		// from this level's score to the full size's
+		float scale;
+	};
+	
+	RiggedModel model;
+	vector<Level*> levels;
+	vector<int> scored;
+	vector<float> labelRating;
+	PoseRandom random;
+};
+
+// searches for the pose that best matches the reference with a population
+// per iteration instead of one sample at a time: candidates are drawn from
+// a gaussian with a separate deviation per dof, scored in parallel, and the
+// best quarter moves the mean and sets the deviations for the next
+// iteration (the cross-entropy method, CMA-ES without the covariance).
+// when the deviations collapse without improving, they're widened again
+// around the best pose so far.
+//
+// with refinement on, a stall first hands the best pose to
+// Levenberg-Marquardt on the chamfer residuals instead. the jacobian comes
+// from one step per dof, drawn in parallel like the population, and a few
+// dampings are tried at once. once no damping improves the pose the
+// population search widens again. the residuals only add up to the chamfer
+// cost, so there's no refinement with the mismatch cost.
+//
+// runs on its own thread after startThread(), or one iteration at a time
+// from the caller with iterate().
+class PoseOptimizer : public ofThread {
+public:
+	PoseOptimizer();
+	~PoseOptimizer();
+	
+	// threads 0 means one per core, every thread loads its own model. levels
+	// is passed on to every PoseEvaluator.
+	bool setup(string modelPath, const ofPixels& reference, int threads = 0, int populationSize = 64, int levels = 1);
+	bool isSetup();
+	// only while the thread isn't running, best scores from another cost
+	// don't compare
+	void setCost(SilhouetteCost cost);
+	// only while the thread isn't running, and only used with the chamfer cost
+	void setRefinement(bool refinement);
+	void reset(HandPose& start, float deviation = .2);
+	void iterate();
+	void stop();
+	
+	// can be called from any thread
+	int getBest(HandPose& pose);
+	int getIterations();
+	int getEvaluations();
+	// iterations spent refining
+	int getRefinements();
+	// how many poses were scored at each level since reset(), only while the
+	// thread isn't running
+	vector<int> getScored();
+	// PoseEvaluator::getDrawnFraction() of getScored()
+	float getDrawnFraction();
+	
+	// called by the worker threads
+	void evaluateCandidates(PoseEvaluator& evaluator);
+	
+protected:
+	void threadedFunction();
+	// scores every candidate on every thread
+	void scoreCandidates(bool residuals);
+	void restart();
+	void refine();
+	
+	vector<PoseEvaluator*> evaluators;
+	vector<ofThread*> workers;
+	Poco::Semaphore start, done;
+	volatile int nextCandidate;
+	// candidates above this at a coarse level are rejected
+	float bound;
+	// when set, candidates are scored at full size and keep their residuals
+	volatile bool keepResiduals;
+	vector< vector<float> > residuals;
+	
+	PoseRandom random;
+	vector<float> mean, deviation, minDeviation, maxDeviation;
+	vector<HandPose> candidates;
+	vector<int> scores;
+	vector< pair<int, int> > order;
+	vector<float> weights;
+	int populationSize, stalled;
+	
+	SilhouetteCost cost;
+	bool refinement, refining;
+	float damping;
+	vector<float> steps;
+	vector<int> active;
+	vector<double> hessian, gradient;
+	
+	ofMutex bestMutex;
+	HandPose best;
+	int bestScore, iterations, evaluations, refinements;
+};
+
+// how many levels width x height has when halving down to 32 pixels
+int getLevelCount(int width, int height);
+
+// runs the single sample hill climber from testApp, then PoseOptimizer
+// without and with refinement, from the same start for the same time. prints
+// when each stopped improving, and how long each took to reach the random
+// search's final score. levels only applies to the population, and the
+// refinement only runs with the chamfer cost.
+void compareOptimizers(string modelPath, const ofPixels& reference, HandPose start, float seconds, int threads = 0, int levels = 1, SilhouetteCost cost = SILHOUETTE_MISMATCH);
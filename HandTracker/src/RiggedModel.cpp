@@ -0,0 +1,19 @@
+#include "RiggedModel.h"
+
+aiMatrix4x4 toAi(ofMatrix4x4 ofMat) {
+	aiMatrix4x4 aiMat;
+	aiMat.a1 = ofMat(0, 0); aiMat.a2 = ofMat(0, 1); aiMat.a3 = ofMat(0, 2); aiMat.a4 = ofMat(0, 3);
+	aiMat.b1 = ofMat(1, 0); aiMat.b2 = ofMat(1, 1); aiMat.b3 = ofMat(1, 2); aiMat.b4 = ofMat(1, 3);
+	aiMat.c1 = ofMat(2, 0); aiMat.c2 = ofMat(2, 1); aiMat.c3 = ofMat(2, 2); aiMat.c4 = ofMat(2, 3);
+	aiMat.d1 = ofMat(3, 0); aiMat.d2 = ofMat(3, 1); aiMat.d3 = ofMat(3, 2); aiMat.d4 = ofMat(3, 3);
+	return aiMat;
+}
+
+ofMatrix4x4 toOf(aiMatrix4x4 aiMat) {
+	ofMatrix4x4 ofMat;
+	ofMat(0, 0) = aiMat.a1; ofMat(0, 1) = aiMat.a2; ofMat(0, 2) = aiMat.a3; ofMat(0, 3) = aiMat.a4;
+	ofMat(1, 0) = aiMat.b1; ofMat(1, 1) = aiMat.b2; ofMat(1, 2) = aiMat.b3; ofMat(1, 3) = aiMat.b4;
+	ofMat(2, 0) = aiMat.c1; ofMat(2, 1) = aiMat.c2; ofMat(2, 2) = aiMat.c3; ofMat(2, 3) = aiMat.c4;
+	ofMat(3, 0) = aiMat.d1; ofMat(3, 1) = aiMat.d2; ofMat(3, 2) = aiMat.d3; ofMat(3, 3) = aiMat.d4;
+	return ofMat;
+}
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxAssimpModelLoader.h"
+#include "aiMesh.h"
+#include "aiScene.h"
+#include "HandPose.h"
+#include "Skinning.h"
+
+aiMatrix4x4 toAi(ofMatrix4x4 ofMat);
+ofMatrix4x4 toOf(aiMatrix4x4 aiMat);
+
+inline bool isHand(string name) {
+	return (name.find("Finger") != string::npos ||
+	 name.find("Wrist") != string::npos ||
+	 name.find("Palm") != string::npos) &&
+	(name.find("_R") != string::npos);
+}
+
+inline bool isControllable(string name) {
+	return (name.find("Finger") != string::npos) &&
+	(name.find("_R") != string::npos);
+}
+
+typedef map<string, aiMatrix4x4> Pose;
+
+class RiggedModel : public ofxAssimpModelLoader {
+protected:
+	// the center of each bone's vertices in the current pose
+	void getJointCenters(vector<aiVector3D>& avg, int which = 0) {
+		const aiMesh* mesh = modelMeshes[which].mesh;
+		int n = mesh->mNumBones;
+		avg.assign(n, aiVector3D());
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			for(int b = 0; b < bone->mNumWeights; b++) {
+				const aiVertexWeight& weight = bone->mWeights[b];
+				size_t vertexId = weight.mVertexId;
+				avg[a] += modelMeshes[which].animatedPos[vertexId];
+			}
+			avg[a] /= bone->mNumWeights;
+		}
+	}
+	
+	// everything about maskedModel that doesn't change with the pose: each
+	// vertex is labeled with its nearest bone in the bind pose, and only
+	// triangles touching the hand are kept
+	void setupTopology(int which = 0) {
+		const aiMesh* mesh = modelMeshes[which].mesh;
+		int n = mesh->mNumBones;
+		if(skinnings.size() <= which) {
+			skinnings.resize(which + 1);
+		}
+		skinnings[which].setup(scene, mesh);
+		skinnings[which].update(modelMeshes[which].animatedPos, modelMeshes[which].animatedNorm);
+		vector<aiVector3D> avg;
+		getJointCenters(avg, which);
+		
+		int m = modelMeshes[which].animatedPos.size();
+		vector< vector<int> > vertexBones(m);
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			for(int b = 0; b < bone->mNumWeights; b++) {
+				vertexBones[bone->mWeights[b].mVertexId].push_back(a);
+			}
+		}
+		
+		vector<int> vertexLabel(m);
+		for(int i = 0; i < m; i++) {
+			float bestDistance = 0;
+			for(int j = 0; j < vertexBones[i].size(); j++) {
+				int cur = vertexBones[i][j];
+				const aiVector3D& joint = avg[cur];
+				const aiVector3D& vertex = modelMeshes[which].animatedPos[i];
+				float dx = joint.x - vertex.x;
+				float dy = joint.y - vertex.y;
+				float dz = joint.z - vertex.z;
+				float distance = dx * dx + dy * dy + dz * dz;
+				if(j == 0 || distance < bestDistance) {
+					vertexLabel[i] = 255 - cur;
+					bestDistance = distance;
+				}
+			}
+		}
+		
+		// maskedCenter averages a vertex once for every hand bone it has
+		handVertices.clear();
+		vector<bool> validVertices(m);
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			string name = bone->mName.data;
+			if(isHand(name)) {
+				for(int b = 0; b < bone->mNumWeights; b++) {
+					int vertexId = bone->mWeights[b].mVertexId;
+					validVertices[vertexId] = true;
+					handVertices.push_back(vertexId);
+				}
+			}
+		}
+		
+		maskedModel.clear();
+		maskedModel.setMode(OF_PRIMITIVE_TRIANGLES);
+		maskedModel.setUsage(GL_DYNAMIC_DRAW);
+		maskedModel.getVertices().resize(m);
+		maskedModel.getNormals().resize(m);
+		for(int i = 0; i < m; i++) {
+			maskedModel.addColor(ofColor(vertexLabel[i]));
+		}
+		for(int i = 0; i < modelMeshes[which].indices.size(); i+= 3) {
+			ofIndexType i0 = modelMeshes[which].indices[i + 0];
+			ofIndexType i1 = modelMeshes[which].indices[i + 1];
+			ofIndexType i2 = modelMeshes[which].indices[i + 2];
+			if(validVertices[i0] || validVertices[i1] || validVertices[i2]) {
+				maskedModel.addIndex(i0);
+				maskedModel.addIndex(i1);
+				maskedModel.addIndex(i2);
+			}
+		}
+		topologyMesh = mesh;
+	}
+	
+	// only positions and normals change from pose to pose
+	void updatePose(int which = 0) {
+		const aiMesh* mesh = modelMeshes[which].mesh;
+		if(topologyMesh != mesh) {
+			setupTopology(which);
+		}
+		vector<aiVector3D>& animatedPos = modelMeshes[which].animatedPos;
+		vector<aiVector3D>& animatedNorm = modelMeshes[which].animatedNorm;
+		skinnings[which].update(animatedPos, animatedNorm);
+		modelMeshes[which].hasChanged = true;
+		modelMeshes[which].validCache = false;
+		
+		maskedCenter.set(0);
+		for(int i = 0; i < handVertices.size(); i++) {
+			const aiVector3D& cur = animatedPos[handVertices[i]];
+			maskedCenter += ofVec3f(cur.x, cur.y, cur.z);
+		}
+		maskedCenter /= handVertices.size();
+		
+		int m = animatedPos.size();
+		ofVec3f* vertices = maskedModel.getVerticesPointer();
+		for(int i = 0; i < m; i++) {
+			vertices[i].set(animatedPos[i].x, animatedPos[i].y, animatedPos[i].z);
+		}
+		ofVec3f* normals = maskedModel.getNormalsPointer();
+		for(int i = 0; i < m; i++) {
+			normals[i].set(animatedNorm[i].x, animatedNorm[i].y, animatedNorm[i].z);
+		}
+		debugPose = -1;
+	}
+	
+	// lines from each bone to its parent, and from each bone to its vertices
+	void updateDebugMeshes(int which = 0) {
+		if(debugPose == which) {
+			return;
+		}
+		const aiMesh* mesh = modelMeshes[which].mesh;
+		int n = mesh->mNumBones;
+		vector<aiVector3D> avg;
+		getJointCenters(avg, which);
+		
+		skeleton.clear();
+		skeleton.setMode(OF_PRIMITIVE_LINES);
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			const aiNode* node = scene->mRootNode->FindNode(bone->mName);
+			if(node->mParent) {
+				for(int b = 0; b < n; b++) {
+					const aiBone* parent = mesh->mBones[b];
+					if(parent->mName == node->mParent->mName) {
+						skeleton.addVertex(ofVec3f(avg[a].x, avg[a].y, avg[a].z));
+						skeleton.addVertex(ofVec3f(avg[b].x, avg[b].y, avg[b].z));
+					}
+				}
+			}
+		}
+		
+		influence.clear();
+		influence.setMode(OF_PRIMITIVE_LINES);
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			for(int b = 0; b < bone->mNumWeights; b++) {
+				const aiVector3D& cur = modelMeshes[which].animatedPos[bone->mWeights[b].mVertexId];
+				influence.addVertex(ofVec3f(avg[a].x, avg[a].y, avg[a].z));
+				influence.addVertex(ofVec3f(cur.x, cur.y, cur.z));
+			}
+		}
+		debugPose = which;
+	}
+	
+	vector<Skinning> skinnings;
+	
+	// from compileHandPose(), indexed by bone
+	vector<aiNode*> boneNodes;
+	vector<aiMatrix4x4> bindTransforms;
+	vector<ofVec3f> boneAngles;
+	// indexed by dof, the bone is -1 when the model doesn't have it
+	vector<int> dofBones, dofAxes;
+	
+	const aiMesh* topologyMesh;
+	vector<int> handVertices;
+	// the mesh the debug meshes were built for, -1 when they're out of date
+	int debugPose;
+	ofMesh skeleton;
+	ofMesh influence;
+	
+public:
+	RiggedModel()
+	:topologyMesh(NULL)
+	,debugPose(-1) {
+	}
+	// also sets up the topology from the bind pose
+	bool loadModel(string modelName, bool optimize = false) {
+		if(!ofxAssimpModelLoader::loadModel(modelName, optimize)) {
+			return false;
+		}
+		setupTopology();
+		return true;
+	}
+	int getBoneCount(int which = 0) {
+		return modelMeshes[which].mesh->mNumBones;
+	}
+	const aiBone* getBone(int i, int which = 0) {
+		return modelMeshes[which].mesh->mBones[i];
+	}
+	Pose getPose(int which = 0) {
+		const aiMesh* mesh = modelMeshes[which].mesh;	
+		int n = mesh->mNumBones;
+		Pose pose;
+		for(int a = 0; a < n; a++) {
+			const aiBone* bone = mesh->mBones[a];
+			aiNode* node = scene->mRootNode->FindNode(bone->mName);
+			pose[node->mName.data] = node->mTransformation;
+		}
+		return pose;
+	}
+	// skip uploading when the model is only drawn with LabelRasterizer
+	void setPose(Pose& pose, int which = 0, bool upload = true) {
+		// load the pose
+		for(Pose::iterator i = pose.begin(); i != pose.end(); i++) {
+			const string& name = i->first;
+			const aiMatrix4x4& mat = i->second;
+			scene->mRootNode->FindNode(name)->mTransformation = mat;
+		}
+		updatePose(which);
+		if(upload) {
+			updateGLResources();
+		}
+	}
+	
+	// binds every dof of handPose to a bone and an axis once, so poses can be
+	// set from an array of values without looking up any names. the dofs
+	// rotate the bones from the current pose.
+	void compileHandPose(HandPose& handPose, int which = 0) {
+		const aiMesh* mesh = modelMeshes[which].mesh;
+		int n = mesh->mNumBones;
+		boneNodes.resize(n);
+		bindTransforms.resize(n);
+		boneAngles.resize(n);
+		for(int a = 0; a < n; a++) {
+			boneNodes[a] = scene->mRootNode->FindNode(mesh->mBones[a]->mName);
+			bindTransforms[a] = boneNodes[a]->mTransformation;
+		}
+		// dofs are named after their bone and axis, like "Finger-2-1_R.z"
+		dofBones.assign(handPose.size(), -1);
+		dofAxes.assign(handPose.size(), 0);
+		for(int i = 0; i < handPose.size(); i++) {
+			string name = handPose.getName(i);
+			size_t dot = name.rfind('.');
+			string boneName = name.substr(0, dot);
+			dofAxes[i] = name[dot + 1] - 'x';
+			for(int a = 0; a < n; a++) {
+				if(boneName == mesh->mBones[a]->mName.data) {
+					dofBones[i] = a;
+				}
+			}
+			if(dofBones[i] < 0) {
+				ofLogWarning() << "no bone for " << name;
+			}
+		}
+	}
+	// the bone a dof rotates, which is also the label it's drawn with
+	int getDofBone(int dof) {
+		return dofBones[dof];
+	}
+	// rotates every bone from the compiled pose by values, one per dof in
+	// HandPose order
+	void setHandPose(const float* values, int which = 0, bool upload = true) {
+		int n = boneNodes.size();
+		for(int a = 0; a < n; a++) {
+			boneAngles[a].set(0);
+		}
+		for(int i = 0; i < dofBones.size(); i++) {
+			if(dofBones[i] >= 0) {
+				boneAngles[dofBones[i]][dofAxes[i]] = values[i];
+			}
+		}
+		for(int a = 0; a < n; a++) {
+			aiMatrix4x4& transform = boneNodes[a]->mTransformation;
+			transform = bindTransforms[a];
+			const ofVec3f& angles = boneAngles[a];
+			if(angles.x != 0 || angles.y != 0 || angles.z != 0) {
+				ofMatrix4x4 mat;
+				ofQuaternion quat(angles.x, ofVec3f(1, 0, 0),
+													angles.y, ofVec3f(0, 1, 0),
+													angles.z, ofVec3f(0, 0, 1));
+				quat.get(mat);
+				transform *= toAi(mat);
+			}
+		}
+		updatePose(which);
+		if(upload) {
+			updateGLResources();
+		}
+	}
+	// the transformation drawSkeleton() applies to maskedModel
+	ofMatrix4x4 getMaskedTransform() {
+		ofMatrix4x4 transform;
+		transform.glTranslate(-scene_center.x, -scene_center.y, scene_center.z);
+		transform.glScale(250, 250, 250);
+		for(int i = 0; i < (int) rotAngle.size(); i++){
+			transform.glRotate(rotAngle[i], rotAxis[i].x, rotAxis[i].y, rotAxis[i].z);
+		}
+		transform.glScale(scale.x, scale.y, scale.z);
+		transform.glRotate(-90, 1, 0, 0);
+		transform.glRotate(-90, 0, 1, 0);
+		transform.glTranslate(-maskedCenter);
+		return transform;
+	}
+	// getMaskedTransform() inside the view the labels are drawn with: the
+	// model's 512x512 area scaled to width x height around the center
+	ofMatrix4x4 getLabelTransform(int width, int height) {
+		ofMatrix4x4 view;
+		view.glTranslate(width / 2, height / 2, 0);
+		view.glScale(width / 512., height / 512., 1);
+		return getMaskedTransform() * view;
+	}
+	void drawSkeleton() {
+		ofPushMatrix();
+		ofMultMatrix(getMaskedTransform());
+		
+		ofSetColor(255);
+		//for(int i = 0; i < 64; i++) {
+			maskedModel.draw();
+		//}
+		//maskedModel.drawWireframe();
+		
+		ofPopMatrix();
+	}
+	
+	// times Skinning against the original bone-major loop on the current pose
+	void benchmarkSkinning(int iterations = 1000, int which = 0) {
+		::benchmarkSkinning(scene, modelMeshes[which].mesh, iterations);
+	}
+	
+	// built on demand, only for drawing
+	ofMesh& getSkeleton(int which = 0) {
+		updateDebugMeshes(which);
+		return skeleton;
+	}
+	ofMesh& getInfluence(int which = 0) {
+		updateDebugMeshes(which);
+		return influence;
+	}
+	
+	ofVboMesh maskedModel;
+	ofVec3f maskedCenter;
+};
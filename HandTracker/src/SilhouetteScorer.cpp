@@ -0,0 +1,262 @@
+#include "SilhouetteScorer.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+// larger than any distance in the image
+static const int farAway = INT_MAX / 2;
+
+SilhouetteScorer::SilhouetteScorer()
+:width(0)
+,height(0)
+,words(0)
+,cost(SILHOUETTE_MISMATCH)
+,outside(0)
+,missed(0)
+,chamfer(0) {
+}
+
+void SilhouetteScorer::setup(const ofPixels& reference) {
+	width = reference.getWidth();
+	height = reference.getHeight();
+	words = (width * height + 63) / 64;
+	referenceBits.resize(words);
+	drawnBits.resize(words);
+	packMask(reference.getPixels(), width * height, &referenceBits[0]);
+	setupDistance(reference.getPixels());
+	labelDifference.resize(256);
+	labelTotal.resize(256);
+}
+
+void SilhouetteScorer::setCost(SilhouetteCost cost) {
+	this->cost = cost;
+}
+
+SilhouetteCost SilhouetteScorer::getCost() const {
+	return cost;
+}
+
+// two passes of the 3-4 chamfer distance, from the pixels that start at 0
+static void chamferDistance(vector<int>& distance, int width, int height) {
+	for(int y = 0; y < height; y++) {
+		for(int x = 0; x < width; x++) {
+			int& cur = distance[y * width + x];
+			if(x > 0) {
+				cur = MIN(cur, distance[y * width + x - 1] + 3);
+			}
+			if(y > 0) {
+				const int* above = &distance[(y - 1) * width];
+				cur = MIN(cur, above[x] + 3);
+				if(x > 0) {
+					cur = MIN(cur, above[x - 1] + 4);
+				}
+				if(x + 1 < width) {
+					cur = MIN(cur, above[x + 1] + 4);
+				}
+			}
+		}
+	}
+	for(int y = height - 1; y >= 0; y--) {
+		for(int x = width - 1; x >= 0; x--) {
+			int& cur = distance[y * width + x];
+			if(x + 1 < width) {
+				cur = MIN(cur, distance[y * width + x + 1] + 3);
+			}
+			if(y + 1 < height) {
+				const int* below = &distance[(y + 1) * width];
+				cur = MIN(cur, below[x] + 3);
+				if(x + 1 < width) {
+					cur = MIN(cur, below[x + 1] + 4);
+				}
+				if(x > 0) {
+					cur = MIN(cur, below[x - 1] + 4);
+				}
+			}
+		}
+	}
+}
+
+// pixels outside the reference cost their distance to it, and pixels inside
+// cost their distance to the background
+void SilhouetteScorer::setupDistance(const unsigned char* pixels) {
+	int n = width * height;
+	vector<int> toReference(n), toBackground(n);
+	for(int i = 0; i < n; i++) {
+		toReference[i] = pixels[i] ? 0 : farAway;
+		toBackground[i] = pixels[i] ? farAway : 0;
+	}
+	chamferDistance(toReference, width, height);
+	chamferDistance(toBackground, width, height);
+	// an empty or full reference has nothing to be close to
+	int limit = 3 * (width + height);
+	distance.resize(n);
+	residualWeights.resize(n);
+	for(int i = 0; i < n; i++) {
+		distance[i] = MIN(pixels[i] ? toBackground[i] : toReference[i], limit);
+		residualWeights[i] = sqrtf(distance[i]);
+	}
+}
+
+#ifdef __SSSE3__
+// the bits set in every 64 bit half of v: a 4 bit lookup table with pshufb,
+// then psadbw to add up the bytes
+static inline __m128i countBits(__m128i v) {
+	const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	__m128i low = _mm_shuffle_epi8(table, _mm_and_si128(v, nibble));
+	__m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+	return _mm_sad_epu8(_mm_add_epi8(low, high), _mm_setzero_si128());
+}
+#endif
+
+// the bits set in a but not b, and in b but not a. __builtin_popcountll is
+// a loop of shifts and masks unless the target has popcnt, so two words at
+// a time go through ssse3 instead.
+static void countDifferent(const uint64_t* a, const uint64_t* b, int words, int& aOnly, int& bOnly) {
+	aOnly = 0;
+	bOnly = 0;
+	int i = 0;
+#ifdef __SSSE3__
+	__m128i aSum = _mm_setzero_si128(), bSum = _mm_setzero_si128();
+	for(; i + 2 <= words; i += 2) {
+		__m128i x = _mm_loadu_si128((const __m128i*) (a + i));
+		__m128i y = _mm_loadu_si128((const __m128i*) (b + i));
+		aSum = _mm_add_epi64(aSum, countBits(_mm_andnot_si128(y, x)));
+		bSum = _mm_add_epi64(bSum, countBits(_mm_andnot_si128(x, y)));
+	}
+	aOnly = _mm_cvtsi128_si32(aSum) + _mm_cvtsi128_si32(_mm_srli_si128(aSum, 8));
+	bOnly = _mm_cvtsi128_si32(bSum) + _mm_cvtsi128_si32(_mm_srli_si128(bSum, 8));
+#endif
+	for(; i < words; i++) {
+		aOnly += __builtin_popcountll(a[i] & ~b[i]);
+		bOnly += __builtin_popcountll(b[i] & ~a[i]);
+	}
+}
+
+int SilhouetteScorer::score(const ofPixels& labels) {
+	if(labels.getWidth() != width || labels.getHeight() != height) {
+		ofLogError() << "labels are " << labels.getWidth() << "x" << labels.getHeight() << ", not " << width << "x" << height;
+		return INT_MAX;
+	}
+	const unsigned char* pixels = labels.getPixels();
+	packMask(pixels, width * height, &drawnBits[0]);
+	fill(labelDifference.begin(), labelDifference.end(), 0);
+	fill(labelTotal.begin(), labelTotal.end(), 0);
+	countDifferent(&drawnBits[0], &referenceBits[0], words, outside, missed);
+	chamfer = 0;
+	for(int i = 0; i < words; i++) {
+		uint64_t drawn = drawnBits[i], reference = referenceBits[i];
+		uint64_t drawnOutside = drawn & ~reference;
+		if(cost == SILHOUETTE_CHAMFER) {
+			const int* cur = &distance[i * 64];
+			for(uint64_t different = drawn ^ reference; different; different &= different - 1) {
+				chamfer += cur[__builtin_ctzll(different)];
+			}
+		}
+		// only the drawn pixels are looked at to count labels
+		const unsigned char* cur = pixels + i * 64;
+		for(; drawn; drawn &= drawn - 1) {
+			labelTotal[255 - cur[__builtin_ctzll(drawn)]]++;
+		}
+		for(; drawnOutside; drawnOutside &= drawnOutside - 1) {
+			labelDifference[255 - cur[__builtin_ctzll(drawnOutside)]]++;
+		}
+	}
+	return cost == SILHOUETTE_CHAMFER ? chamfer : outside + missed;
+}
+
+int SilhouetteScorer::getOutside() const {
+	return outside;
+}
+
+int SilhouetteScorer::getMissed() const {
+	return missed;
+}
+
+int SilhouetteScorer::getMismatch() const {
+	return outside + missed;
+}
+
+int SilhouetteScorer::getChamfer() const {
+	return chamfer;
+}
+
+const vector<int>& SilhouetteScorer::getLabelDifference() const {
+	return labelDifference;
+}
+
+const vector<int>& SilhouetteScorer::getLabelTotal() const {
+	return labelTotal;
+}
+
+void SilhouetteScorer::getResiduals(vector<float>& residuals) const {
+	residuals.assign(width * height, 0);
+	for(int i = 0; i < words; i++) {
+		const float* cur = &residualWeights[i * 64];
+		float* residual = &residuals[i * 64];
+		for(uint64_t different = drawnBits[i] ^ referenceBits[i]; different; different &= different - 1) {
+			int bit = __builtin_ctzll(different);
+			residual[bit] = cur[bit];
+		}
+	}
+}
+
+void packMask(const unsigned char* pixels, int n, uint64_t* bits) {
+	int full = n / 64;
+	for(int i = 0; i < full; i++) {
+		const unsigned char* cur = pixels + i * 64;
+#ifdef __SSE2__
+		__m128i zero = _mm_setzero_si128();
+		uint64_t word = 0;
+		for(int j = 0; j < 4; j++) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*) (cur + j * 16));
+			uint64_t empty = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+			word |= (~empty & 0xffff) << (j * 16);
+		}
+		bits[i] = word;
+#else
+		uint64_t word = 0;
+		for(int j = 0; j < 64; j++) {
+			if(cur[j]) {
+				word |= (uint64_t) 1 << j;
+			}
+		}
+		bits[i] = word;
+#endif
+	}
+	if(full * 64 < n) {
+		uint64_t word = 0;
+		for(int j = 0; full * 64 + j < n; j++) {
+			if(pixels[full * 64 + j]) {
+				word |= (uint64_t) 1 << j;
+			}
+		}
+		bits[full] = word;
+	}
+}
+
+void resizeMask(const ofPixels& mask, ofPixels& resized, int width, int height) {
+	int maskWidth = mask.getWidth(), maskHeight = mask.getHeight();
+	resized.allocate(width, height, OF_IMAGE_GRAYSCALE);
+	const unsigned char* src = mask.getPixels();
+	unsigned char* dst = resized.getPixels();
+	for(int y = 0; y < height; y++) {
+		int top = y * maskHeight / height, bottom = MAX((y + 1) * maskHeight / height, top + 1);
+		for(int x = 0; x < width; x++) {
+			int left = x * maskWidth / width, right = MAX((x + 1) * maskWidth / width, left + 1);
+			int set = 0;
+			for(int i = top; i < bottom; i++) {
+				for(int j = left; j < right; j++) {
+					if(src[i * maskWidth + j]) {
+						set++;
+					}
+				}
+			}
+			dst[y * width + x] = 2 * set >= (bottom - top) * (right - left) ? 255 : 0;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+
+enum SilhouetteCost {
+	// pixels drawn outside the reference plus reference pixels left uncovered
+	SILHOUETTE_MISMATCH = 0,
+	// the same pixels, each weighted by how far it is from the reference's
+	// outline, so the cost keeps falling as a pose gets closer
+	SILHOUETTE_CHAMFER
+};
+
+// compares label images to a reference silhouette. both are packed into one
+// bit per pixel, so the mismatch is an xor and a popcount per 64 pixels, and
+// only drawn pixels are visited to count each label. the chamfer cost uses
+// a 3-4 distance transform of the reference that's computed once in setup().
+class SilhouetteScorer {
+public:
+	SilhouetteScorer();
+
+	// reference is one byte per pixel with 0 for the background
+	void setup(const ofPixels& reference);
+	void setCost(SilhouetteCost cost);
+	SilhouetteCost getCost() const;
+
+	// labels is one byte per pixel the size of the reference, 0 where nothing
+	// was drawn and 255 - bone elsewhere. returns the cost.
+	int score(const ofPixels& labels);
+
+	// from the last score()
+	int getOutside() const;
+	int getMissed() const;
+	int getMismatch() const;
+	// in thirds of a pixel
+	int getChamfer() const;
+	// by bone: pixels drawn outside the reference, and pixels drawn
+	const vector<int>& getLabelDifference() const;
+	const vector<int>& getLabelTotal() const;
+	// one per pixel from the last score(), whose squares add up to the
+	// chamfer cost: the square root of the distance where the labels and the
+	// reference differ, 0 elsewhere
+	void getResiduals(vector<float>& residuals) const;
+
+protected:
+	void setupDistance(const unsigned char* pixels);
+
+	int width, height, words;
+	SilhouetteCost cost;
+	vector<uint64_t> referenceBits, drawnBits;
+	// the distance to the other side of the outline, for every pixel
+	vector<int> distance;
+	vector<float> residualWeights;
+	int outside, missed, chamfer;
+	vector<int> labelDifference, labelTotal;
+};
+
+// one bit per pixel, set where the pixel isn't 0, in words of 64 pixels
+// with the first pixel in the lowest bit
+void packMask(const unsigned char* pixels, int n, uint64_t* bits);
+
+// scales a mask to width x height: each pixel is set when at least half of
+// the pixels it covers are, or when the one it falls on is when scaling up
+void resizeMask(const ofPixels& mask, ofPixels& resized, int width, int height);
@@ -0,0 +1,259 @@
+#include "Skinning.h"
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+Skinning::Skinning()
+:mesh(NULL)
+,influences(0) {
+}
+
+// adds node after its ancestors, returns its index
+static int addNode(const aiNode* node, vector<const aiNode*>& nodes, vector<int>& parents, map<const aiNode*, int>& indices) {
+	map<const aiNode*, int>::iterator found = indices.find(node);
+	if(found != indices.end()) {
+		return found->second;
+	}
+	int parent = node->mParent ? addNode(node->mParent, nodes, parents, indices) : -1;
+	int index = nodes.size();
+	nodes.push_back(node);
+	parents.push_back(parent);
+	indices[node] = index;
+	return index;
+}
+
+void Skinning::setup(const aiScene* scene, const aiMesh* mesh, int maxInfluences) {
+	this->mesh = mesh;
+	int n = mesh->mNumBones;
+	nodes.clear();
+	parents.clear();
+	boneNodes.resize(n);
+	map<const aiNode*, int> indices;
+	for(int a = 0; a < n; a++) {
+		const aiNode* node = scene->mRootNode->FindNode(mesh->mBones[a]->mName);
+		boneNodes[a] = addNode(node, nodes, parents, indices);
+	}
+	globals.resize(nodes.size());
+	boneColumns.resize(16 * n);
+	
+	// gather every vertex's weights, heaviest first
+	int m = mesh->mNumVertices;
+	vector< vector< pair<float, int> > > weights(m);
+	for(int a = 0; a < n; a++) {
+		const aiBone* bone = mesh->mBones[a];
+		for(int b = 0; b < bone->mNumWeights; b++) {
+			const aiVertexWeight& weight = bone->mWeights[b];
+			weights[weight.mVertexId].push_back(pair<float, int>(-weight.mWeight, a));
+		}
+	}
+	influences = 0;
+	int capped = 0;
+	for(int i = 0; i < m; i++) {
+		ofSort(weights[i]);
+		influences = MAX(influences, MIN((int) weights[i].size(), maxInfluences));
+		if(weights[i].size() > maxInfluences) {
+			capped++;
+		}
+	}
+	if(capped > 0) {
+		ofLogWarning() << capped << " vertices have more than " << maxInfluences << " bones, keeping the heaviest";
+	}
+	vertexBones.assign(influences, vector<int>(m, 0));
+	vertexWeights.assign(influences, vector<float>(m, 0));
+	for(int i = 0; i < m; i++) {
+		int count = MIN((int) weights[i].size(), influences);
+		float total = 0, kept = 0;
+		for(int j = 0; j < weights[i].size(); j++) {
+			total -= weights[i][j].first;
+		}
+		for(int j = 0; j < count; j++) {
+			kept -= weights[i][j].first;
+		}
+		float scale = count < weights[i].size() && kept > 0 ? total / kept : 1;
+		for(int j = 0; j < count; j++) {
+			vertexBones[j][i] = weights[i][j].second;
+			vertexWeights[j][i] = -weights[i][j].first * scale;
+		}
+	}
+	
+	// positions and normals padded to four floats
+	sourcePositions.assign(4 * m, 0);
+	sourceNormals.assign(4 * m, 0);
+	for(int i = 0; i < m; i++) {
+		sourcePositions[4 * i + 0] = mesh->mVertices[i].x;
+		sourcePositions[4 * i + 1] = mesh->mVertices[i].y;
+		sourcePositions[4 * i + 2] = mesh->mVertices[i].z;
+		sourcePositions[4 * i + 3] = 1;
+		if(mesh->HasNormals()) {
+			sourceNormals[4 * i + 0] = mesh->mNormals[i].x;
+			sourceNormals[4 * i + 1] = mesh->mNormals[i].y;
+			sourceNormals[4 * i + 2] = mesh->mNormals[i].z;
+		}
+	}
+}
+
+bool Skinning::isSetup(const aiMesh* mesh) const {
+	return this->mesh == mesh;
+}
+
+int Skinning::getInfluences() const {
+	return influences;
+}
+
+void Skinning::update(vector<aiVector3D>& positions, vector<aiVector3D>& normals) {
+	for(int i = 0; i < nodes.size(); i++) {
+		if(parents[i] < 0) {
+			globals[i] = nodes[i]->mTransformation;
+		} else {
+			globals[i] = globals[parents[i]] * nodes[i]->mTransformation;
+		}
+	}
+	int n = boneNodes.size();
+	for(int a = 0; a < n; a++) {
+		aiMatrix4x4 bone = globals[boneNodes[a]] * mesh->mBones[a]->mOffsetMatrix;
+		float* columns = &boneColumns[16 * a];
+		columns[0] = bone.a1; columns[1] = bone.b1; columns[2] = bone.c1; columns[3] = 0;
+		columns[4] = bone.a2; columns[5] = bone.b2; columns[6] = bone.c2; columns[7] = 0;
+		columns[8] = bone.a3; columns[9] = bone.b3; columns[10] = bone.c3; columns[11] = 0;
+		columns[12] = bone.a4; columns[13] = bone.b4; columns[14] = bone.c4; columns[15] = 0;
+	}
+	
+	int m = mesh->mNumVertices;
+	positions.resize(m);
+	bool hasNormals = mesh->HasNormals();
+	if(hasNormals) {
+		normals.resize(m);
+	}
+	const float* source = &sourcePositions[0];
+	const float* sourceNormal = &sourceNormals[0];
+	for(int i = 0; i < m; i++) {
+#ifdef __SSE__
+		// the weighted sum of the bone matrices, then one transform
+		__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+		for(int k = 0; k < influences; k++) {
+			__m128 weight = _mm_set1_ps(vertexWeights[k][i]);
+			const float* columns = &boneColumns[16 * vertexBones[k][i]];
+			c0 = _mm_add_ps(c0, _mm_mul_ps(weight, _mm_loadu_ps(columns + 0)));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(weight, _mm_loadu_ps(columns + 4)));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(weight, _mm_loadu_ps(columns + 8)));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(weight, _mm_loadu_ps(columns + 12)));
+		}
+		const float* p = source + 4 * i;
+		__m128 position = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])), _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+			_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3));
+		float out[4];
+		_mm_storeu_ps(out, position);
+		positions[i].x = out[0];
+		positions[i].y = out[1];
+		positions[i].z = out[2];
+		if(hasNormals) {
+			const float* q = sourceNormal + 4 * i;
+			__m128 normal = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(q[0])), _mm_mul_ps(c1, _mm_set1_ps(q[1]))),
+				_mm_mul_ps(c2, _mm_set1_ps(q[2])));
+			_mm_storeu_ps(out, normal);
+			normals[i].x = out[0];
+			normals[i].y = out[1];
+			normals[i].z = out[2];
+		}
+#else
+		float c[16] = {0};
+		for(int k = 0; k < influences; k++) {
+			float weight = vertexWeights[k][i];
+			const float* columns = &boneColumns[16 * vertexBones[k][i]];
+			for(int j = 0; j < 16; j++) {
+				c[j] += weight * columns[j];
+			}
+		}
+		const float* p = source + 4 * i;
+		positions[i].x = c[0] * p[0] + c[4] * p[1] + c[8] * p[2] + c[12];
+		positions[i].y = c[1] * p[0] + c[5] * p[1] + c[9] * p[2] + c[13];
+		positions[i].z = c[2] * p[0] + c[6] * p[1] + c[10] * p[2] + c[14];
+		if(hasNormals) {
+			const float* q = sourceNormal + 4 * i;
+			normals[i].x = c[0] * q[0] + c[4] * q[1] + c[8] * q[2];
+			normals[i].y = c[1] * q[0] + c[5] * q[1] + c[9] * q[2];
+			normals[i].z = c[2] * q[0] + c[6] * q[1] + c[10] * q[2];
+		}
+#endif
+	}
+}
+
+void skinBoneMajor(const aiScene* scene, const aiMesh* mesh, vector<aiVector3D>& positions, vector<aiVector3D>& normals) {
+	int n = mesh->mNumBones;
+	vector<aiMatrix4x4> boneMatrices(n);
+	for(int a = 0; a < n; a++) {
+		const aiBone* bone = mesh->mBones[a];
+		boneMatrices[a] = bone->mOffsetMatrix;
+		const aiNode* node = scene->mRootNode->FindNode(bone->mName);
+		while(node) {
+			boneMatrices[a] = node->mTransformation * boneMatrices[a];
+			node = node->mParent;
+		}
+	}
+	
+	positions.assign(mesh->mNumVertices, aiVector3D());
+	if(mesh->HasNormals()){
+		normals.assign(mesh->mNumVertices, aiVector3D());
+	}
+	
+	// loop through all vertex weights of all bones
+	for(int a = 0; a < n; a++) {
+		const aiBone* bone = mesh->mBones[a];
+		const aiMatrix4x4& posTrafo = boneMatrices[a];
+		for(int b = 0; b < bone->mNumWeights; b++) {
+			const aiVertexWeight& weight = bone->mWeights[b];
+			size_t vertexId = weight.mVertexId;
+			const aiVector3D& srcPos = mesh->mVertices[vertexId];
+			positions[vertexId] += weight.mWeight * (posTrafo * srcPos);
+		}
+		if(mesh->HasNormals()) {
+			// 3x3 matrix, contains the bone matrix without the translation, only with rotation and possibly scaling
+			aiMatrix3x3 normTrafo = aiMatrix3x3( posTrafo);
+			for( size_t b = 0; b < bone->mNumWeights; b++) {
+				const aiVertexWeight& weight = bone->mWeights[b];
+				size_t vertexId = weight.mVertexId;
+				const aiVector3D& srcNorm = mesh->mNormals[vertexId];
+				normals[vertexId] += weight.mWeight * (normTrafo * srcNorm);
+			}
+		}
+	}
+}
+
+static float getMaxDifference(const vector<aiVector3D>& a, const vector<aiVector3D>& b) {
+	float difference = 0;
+	for(int i = 0; i < a.size() && i < b.size(); i++) {
+		difference = MAX(difference, fabsf(a[i].x - b[i].x));
+		difference = MAX(difference, fabsf(a[i].y - b[i].y));
+		difference = MAX(difference, fabsf(a[i].z - b[i].z));
+	}
+	return difference;
+}
+
+void benchmarkSkinning(const aiScene* scene, const aiMesh* mesh, int iterations) {
+	vector<aiVector3D> positions, normals, referencePositions, referenceNormals;
+	
+	unsigned long long start = ofGetElapsedTimeMicros();
+	for(int i = 0; i < iterations; i++) {
+		skinBoneMajor(scene, mesh, referencePositions, referenceNormals);
+	}
+	unsigned long long boneMajor = ofGetElapsedTimeMicros() - start;
+	
+	start = ofGetElapsedTimeMicros();
+	Skinning skinning;
+	skinning.setup(scene, mesh);
+	unsigned long long setup = ofGetElapsedTimeMicros() - start;
+	start = ofGetElapsedTimeMicros();
+	for(int i = 0; i < iterations; i++) {
+		skinning.update(positions, normals);
+	}
+	unsigned long long compiled = ofGetElapsedTimeMicros() - start;
+	
+	cout << mesh->mNumVertices << " vertices, " << mesh->mNumBones << " bones, up to " << skinning.getInfluences() << " per vertex" << endl;
+	cout << "bone-major " << (float) boneMajor / iterations << "us, compiled " << (float) compiled / iterations << "us ("
+		<< (float) boneMajor / compiled << "x) after " << setup << "us of setup" << endl;
+	cout << "largest difference " << getMaxDifference(positions, referencePositions) << " in positions, "
+		<< getMaxDifference(normals, referenceNormals) << " in normals" << endl;
+}
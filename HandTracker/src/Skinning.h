@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ofMain.h"
+#include "aiMesh.h"
+#include "aiScene.h"
+
+// linear blend skinning compiled for one mesh. setup() resolves the bones'
+// nodes and all their ancestors into arrays ordered parents first, so the
+// global transforms come from one pass without searching the scene, and
+// stores each vertex's bone weights vertex-major, one array per influence.
+// update() blends each vertex's bone matrices with SSE and transforms its
+// position and normal once, instead of accumulating bone by bone.
+class Skinning {
+public:
+	Skinning();
+	// vertices with more than maxInfluences bones keep the heaviest ones,
+	// renormalized. the result only matches bone-major skinning exactly
+	// when no vertex has more.
+	void setup(const aiScene* scene, const aiMesh* mesh, int maxInfluences = 4);
+	bool isSetup(const aiMesh* mesh) const;
+	// reads the current node transformations
+	void update(vector<aiVector3D>& positions, vector<aiVector3D>& normals);
+	
+	int getInfluences() const;
+	
+protected:
+	const aiMesh* mesh;
+	vector<const aiNode*> nodes;
+	vector<int> parents;
+	vector<aiMatrix4x4> globals;
+	vector<int> boneNodes;
+	// each bone's matrix as four columns of four floats, for SSE
+	vector<float> boneColumns;
+	
+	int influences;
+	// influences arrays of vertex count entries
+	vector< vector<int> > vertexBones;
+	vector< vector<float> > vertexWeights;
+	vector<float> sourcePositions, sourceNormals;
+};
+
+// the original bone-major skinning, for checking and timing Skinning
+void skinBoneMajor(const aiScene* scene, const aiMesh* mesh, vector<aiVector3D>& positions, vector<aiVector3D>& normals);
+
+// times both on the current pose and prints the speedup and the largest
+// difference between them
+void benchmarkSkinning(const aiScene* scene, const aiMesh* mesh, int iterations = 1000);
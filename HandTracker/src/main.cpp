@@ -1,10 +1,19 @@
 #include "ofMain.h"
 #include "testApp.h"
+#include "PoseLibrary.h"
 #include "ofAppGlutWindow.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
 	ofAppGlutWindow window;
 	ofSetupOpenGL(&window, 512, 512, OF_WINDOW);
+	
+	// HandTracker --build-library <poses> [<library>]
+	// the window is only there for the GL context the model needs
+	if(argc > 2 && string(argv[1]) == "--build-library") {
+		string path = argc > 3 ? argv[3] : "poses.library";
+		return buildPoseLibrary("rigged-human.dae", path, ofToInt(argv[2])) ? 0 : 1;
+	}
+	
 	ofRunApp( new testApp());
 }
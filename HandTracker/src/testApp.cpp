@@ -2,24 +2,6 @@
 
 using namespace ofxMiniGui;
 
-aiMatrix4x4 toAi(ofMatrix4x4 ofMat) {
-	aiMatrix4x4 aiMat;
-	aiMat.a1 = ofMat(0, 0); aiMat.a2 = ofMat(0, 1); aiMat.a3 = ofMat(0, 2); aiMat.a4 = ofMat(0, 3);
-	aiMat.b1 = ofMat(1, 0); aiMat.b2 = ofMat(1, 1); aiMat.b3 = ofMat(1, 2); aiMat.b4 = ofMat(1, 3);
-	aiMat.c1 = ofMat(2, 0); aiMat.c2 = ofMat(2, 1); aiMat.c3 = ofMat(2, 2); aiMat.c4 = ofMat(2, 3);
-	aiMat.d1 = ofMat(3, 0); aiMat.d2 = ofMat(3, 1); aiMat.d3 = ofMat(3, 2); aiMat.d4 = ofMat(3, 3);
-	return aiMat;
-}
-
-ofMatrix4x4 toOf(aiMatrix4x4 aiMat) {
-	ofMatrix4x4 ofMat;
-	ofMat(0, 0) = aiMat.a1; ofMat(0, 1) = aiMat.a2; ofMat(0, 2) = aiMat.a3; ofMat(0, 3) = aiMat.a4;
-	ofMat(1, 0) = aiMat.b1; ofMat(1, 1) = aiMat.b2; ofMat(1, 2) = aiMat.b3; ofMat(1, 3) = aiMat.b4;
-	ofMat(2, 0) = aiMat.c1; ofMat(2, 1) = aiMat.c2; ofMat(2, 2) = aiMat.c3; ofMat(2, 3) = aiMat.c4;
-	ofMat(3, 0) = aiMat.d1; ofMat(3, 1) = aiMat.d2; ofMat(3, 2) = aiMat.d3; ofMat(3, 3) = aiMat.d4;
-	return ofMat;
-}
-
 void applyMatrix(const ofMatrix4x4& matrix) {
 	glMultMatrixf((GLfloat*) matrix.getPtr());
 }
@@ -58,11 +40,18 @@ void testApp::setup(){
 	reference.loadImage("three.png");
 	reference.setImageType(OF_IMAGE_GRAYSCALE);
 	reference.update();
+	scorer.setup(reference.getPixelsRef());
+	loadOptimizerReference("three-large.png");
 	int side = 128;
 	fbo.allocate(side, side);
+	rasterizer.setup(side, side);
+	useRasterizer = false;
+	refinement = true;
+	rendered.allocate(side, side, OF_IMAGE_GRAYSCALE);
+	optimizing = false;
 	
 	best.allocate(side, side, OF_IMAGE_GRAYSCALE);
-	bestDifference = side * side;
+	bestDifference = INT_MAX;
 	rating = 1;
 	iterations = 0;
 	
@@ -70,24 +59,105 @@ void testApp::setup(){
 	
 	ofDisableArbTex();
 	if(model.loadModel("rigged-human.dae")){
-		bindPose = model.getPose();
+		model.compileHandPose(handPose);
+		labelRating.assign(handPose.size(), 0);
 		for(int i =0; i < handPose.size(); i++) {
 			gui.add(Slider(handPose.getName(i), handPose.getMin(i), handPose.getMax(i), 0));
 		}
 	}
 	
-	handPose.load("three.txt");
-	handPose.randomDeviation(.2);
+	if(!ofFile::doesFileExist("poses.library") || !library.open("poses.library") || !startFromLibrary()) {
+		handPose.load("three.txt");
+		handPose.randomDeviation(.2);
+	}
 	updateGuiFromPose();
 	
 	updateModel();
 }
 
 void testApp::update(){	
-	randomPose();
+	// the sliders are only read once a frame, in case they were dragged
+	updatePoseFromGui();
+	if(optimizing) {
+		optimizer.getBest(handPose);
+		updateGuiFromPose();
+	} else {
+		randomPose();
+	}
 	updateModel();
 }
 
+// a copy of the reference drawn at a higher resolution, 256 to 512px, and
+// framed the same way. scaling the reference up would only cost more.
+void testApp::loadOptimizerReference(string path) {
+	optimizerReference = reference.getPixelsRef();
+	if(!ofFile::doesFileExist(path)) {
+		return;
+	}
+	ofImage large;
+	if(!large.loadImage(path)) {
+		return;
+	}
+	large.setImageType(OF_IMAGE_GRAYSCALE);
+	if(large.getWidth() * reference.getHeight() != large.getHeight() * reference.getWidth()) {
+		ofLogWarning() << path << " isn't framed like the reference, fitting at " << reference.getWidth() << "px";
+		return;
+	}
+	optimizerReference = large.getPixelsRef();
+}
+
+void testApp::toggleOptimizer() {
+	if(optimizing) {
+		optimizer.stop();
+		cout << optimizer.getIterations() << " iterations, " << optimizer.getEvaluations() << " poses";
+		vector<int> scored = optimizer.getScored();
+		cout << ", " << scored[0] << " drawn at " << optimizerReference.getWidth() << "px, " << (int) (100 * optimizer.getDrawnFraction()) << "% of the full size pixels drawn per pose, ";
+		cout << optimizer.getRefinements() << " iterations refined" << endl;
+	} else {
+		if(!optimizer.isSetup()) {
+			// coarser levels down to 32px reject poses that are far off
+			int levels = getLevelCount(optimizerReference.getWidth(), optimizerReference.getHeight());
+			if(!optimizer.setup("rigged-human.dae", optimizerReference, 0, 64, levels)) {
+				return;
+			}
+		}
+		optimizer.setCost(scorer.getCost());
+		optimizer.setRefinement(refinement);
+		optimizer.reset(handPose);
+		optimizer.startThread(true, false);
+	}
+	optimizing = !optimizing;
+}
+
+// draws the library's closest poses to the reference and starts from the
+// one that scores best
+bool testApp::startFromLibrary() {
+	unsigned long long start = ofGetElapsedTimeMicros();
+	vector<PoseMatch> matches;
+	library.search(reference.getPixelsRef(), 16, matches);
+	unsigned long long searched = ofGetElapsedTimeMicros();
+	if(matches.empty()) {
+		return false;
+	}
+	HandPose pose;
+	int bestScore = INT_MAX;
+	for(int i = 0; i < matches.size(); i++) {
+		library.getPose(matches[i].index, pose);
+		model.setHandPose(pose.getValues(), 0, false);
+		rasterizer.draw(model.maskedModel, model.getLabelTransform(fbo.getWidth(), fbo.getHeight()));
+		int score = scorer.score(rasterizer.getPixels());
+		if(score < bestScore) {
+			bestScore = score;
+			handPose = pose;
+		}
+	}
+	cout << "searched " << library.size() << " poses in " << ((searched - start) / 1000.) << "ms, starting from a score of "
+		<< bestScore << " after " << ((ofGetElapsedTimeMicros() - start) / 1000.) << "ms" << endl;
+	bestDifference = INT_MAX;
+	iterations = 0;
+	return true;
+}
+
 void testApp::updateGuiFromPose() {
 	for(int i = 0; i < handPose.size(); i++) {
 		gui.set(handPose.getName(i), handPose.getValue(i));
@@ -101,63 +171,20 @@ void testApp::updatePoseFromGui() {
 }
 
 void testApp::updateModel() {
-	updatePoseFromGui();
-	
-	Pose pose = bindPose;
-	for(Pose::iterator i = pose.begin(); i != pose.end(); i++) {
-		string name = i->first;
-		
-		float x = gui.exists(name + ".x") ? gui.get(name + ".x").getValue() : 0;
-		float y = gui.exists(name + ".y") ? gui.get(name + ".y").getValue() : 0;
-		float z = gui.exists(name + ".z") ? gui.get(name + ".z").getValue() : 0;
-		
-		aiMatrix4x4& bone = i->second;
-		
-		aiMatrix4x4 cur;
-		ofMatrix4x4 mat;
-		ofQuaternion quat(x, ofVec3f(1, 0, 0),
-											y, ofVec3f(0, 1, 0),
-											z, ofVec3f(0, 0, 1));
-		quat.get(mat);
-		cur = toAi(mat);
-		
-		bone *= cur;
-	}
-	model.setPose(pose);
-}
-
-void testApp::updateDifference() {
-	ofPixels current;
-	fbo.readToPixels(current);
-	current.setImageType(OF_IMAGE_GRAYSCALE);
-	int width = current.getWidth(), height = current.getHeight();
-	int n = width * height, difference = 0;
-	int boneCount = model.getBoneCount();
-	labelDifference = vector<int>(boneCount);
-	labelTotal = vector<int>(boneCount);
-	unsigned char* referencePixels = reference.getPixels();
-	unsigned char* currentPixels = current.getPixels();
-	for(int i = 0; i < n; i++) {
-		if(currentPixels[i] > 0) {
-			int label = 255 - currentPixels[i];
-			if(referencePixels[i] == 0) {
-				labelDifference[label]++;
-				difference++;
-			}
-			labelTotal[label]++;
-		}
-	}
-	rating = (float) difference / n;
+	model.setHandPose(handPose.getValues(), 0, !useRasterizer);
+}
+
+void testApp::updateDifference(const ofPixels& current) {
+	int difference = scorer.score(current);
+	rating = (float) scorer.getMismatch() / (current.getWidth() * current.getHeight());
+	const vector<int>& labelDifference = scorer.getLabelDifference();
+	const vector<int>& labelTotal = scorer.getLabelTotal();
 	
-	// pose iteration order is different than bone order
-	for(int i = 0; i < boneCount; i++) {
-		const aiBone* bone = model.getBone(i);
-		if(labelTotal[i] > 0) {
-			string name = bone->mName.data;
-			float curRating = (float) labelDifference[i] / labelTotal[i];
-			labelRating[name + ".x"] = curRating;
-			labelRating[name + ".y"] = curRating;
-			labelRating[name + ".z"] = curRating;
+	// each dof is rated by the bone it rotates
+	for(int i = 0; i < labelRating.size(); i++) {
+		int bone = model.getDofBone(i);
+		if(bone >= 0 && labelTotal[bone] > 0) {
+			labelRating[i] = (float) labelDifference[bone] / labelTotal[bone];
 		}
 	}
 	if(difference < bestDifference) {
@@ -169,9 +196,12 @@ void testApp::updateDifference() {
 	}
 }
 
-void testApp::draw(){
-	ofBackground(128);
-	
+void testApp::drawLabels(ofPixels& labels, bool cpu) {
+	if(cpu) {
+		rasterizer.draw(model.maskedModel, model.getLabelTransform(fbo.getWidth(), fbo.getHeight()));
+		labels = rasterizer.getPixels();
+		return;
+	}
 	fbo.begin();
 	ofClear(0, 255);
 	ofSetupScreenOrtho(fbo.getWidth(), fbo.getHeight(), OF_ORIENTATION_DEFAULT, false, -1000, 1000);
@@ -182,16 +212,71 @@ void testApp::draw(){
 	glShadeModel(GL_FLAT); // important for not smoothing color labels
 	model.drawSkeleton();
 	fbo.end();
-	
-	updateDifference();
-	
 	glDisable(GL_DEPTH_TEST);
+	// the labels are gray, so the red channel is enough
+	fbo.readToPixels(fboPixels);
+	int channels = fboPixels.getNumChannels();
+	if(labels.getWidth() != fboPixels.getWidth() || labels.getHeight() != fboPixels.getHeight()) {
+		labels.allocate(fboPixels.getWidth(), fboPixels.getHeight(), OF_IMAGE_GRAYSCALE);
+	}
+	for(int i = 0; i < labels.size(); i++) {
+		labels[i] = fboPixels[i * channels];
+	}
+}
+
+// prints how many pixels of the current pose differ between the fbo and
+// the rasterizer
+void testApp::compareRasterizer() {
+	ofPixels gpu, cpu;
+	drawLabels(gpu, false);
+	drawLabels(cpu, true);
+	int different = 0, drawn = 0;
+	for(int i = 0; i < gpu.size(); i++) {
+		if(gpu[i] != cpu[i]) {
+			different++;
+		}
+		if(gpu[i] > 0) {
+			drawn++;
+		}
+	}
+	cout << different << " of " << drawn << " drawn pixels differ" << endl;
+}
+
+// times skinning and rasterizing random poses around the current one
+void testApp::benchmarkRasterizer() {
+	HandPose current = handPose;
+	int poses = 1000;
+	float skinning = 0, rasterizing = 0;
+	for(int i = 0; i < poses; i++) {
+		handPose = current;
+		handPose.randomDeviation(.1);
+		float start = ofGetElapsedTimef();
+		updateModel();
+		float skinned = ofGetElapsedTimef();
+		rasterizer.draw(model.maskedModel, model.getLabelTransform(fbo.getWidth(), fbo.getHeight()));
+		float rasterized = ofGetElapsedTimef();
+		skinning += skinned - start;
+		rasterizing += rasterized - skinned;
+	}
+	handPose = current;
+	updateGuiFromPose();
+	updateModel();
+	cout << "skinning " << (1000 * skinning / poses) << "ms, rasterizing " << (1000 * rasterizing / poses) << "ms, "
+		<< (poses / (skinning + rasterizing)) << " poses/s" << endl;
+}
+
+void testApp::draw(){
+	ofBackground(128);
+	
+	drawLabels(labels, useRasterizer);
+	updateDifference(labels);
+	rendered.setFromPixels(labels);
 	
 	ofSetColor(255);
 	ofEnableBlendMode(OF_BLENDMODE_ADD);
 	ofSetColor(255, 128, 0);
-	fbo.setAnchorPercent(.5, 1);
-	fbo.draw(ofGetWidth() / 2, ofGetHeight() / 2);
+	rendered.setAnchorPercent(.5, 1);
+	rendered.draw(ofGetWidth() / 2, ofGetHeight() / 2);
 	ofSetColor(0, 128, 255);
 	reference.setAnchorPercent(.5, 1);
 	reference.draw(ofGetWidth() / 2, ofGetHeight() / 2);
@@ -205,8 +290,8 @@ void testApp::draw(){
 
 	ofSetColor(255);
 	ofPushMatrix();
-	for(map<string, float>::iterator itr = labelRating.begin(); itr != labelRating.end(); itr++) {
-		ofRect(0, 0, 0, 4, itr->second * 100);
+	for(int i = 0; i < labelRating.size(); i++) {
+		ofRect(0, 0, 0, 4, labelRating[i] * 100);
 		ofTranslate(4, 0);
 	}
 	ofPopMatrix();
@@ -218,9 +303,46 @@ void testApp::keyPressed(int key) {
 		updateModel();
 	}
 	if(key == 's') {
-		ofPixels pixels;
-		fbo.readToPixels(pixels);
-		ofSaveImage(pixels, "out.png");
+		ofSaveImage(rendered.getPixelsRef(), "out.png");
 		handPose.save("out.txt");
 	}
+	if(key == 'c') {
+		useRasterizer = !useRasterizer;
+		cout << (useRasterizer ? "drawing labels on the cpu" : "drawing labels with the fbo") << endl;
+	}
+	if(key == 'd') {
+		bool chamfer = scorer.getCost() == SILHOUETTE_CHAMFER;
+		scorer.setCost(chamfer ? SILHOUETTE_MISMATCH : SILHOUETTE_CHAMFER);
+		// scores from the other cost don't compare
+		bestDifference = INT_MAX;
+		cout << (chamfer ? "scoring mismatched pixels" : "scoring chamfer distance") << endl;
+	}
+	if(key == 'v') {
+		compareRasterizer();
+	}
+	if(key == 'b') {
+		benchmarkRasterizer();
+	}
+	if(key == 'k') {
+		model.benchmarkSkinning();
+	}
+	if(key == 'p') {
+		toggleOptimizer();
+	}
+	if(key == 'g') {
+		refinement = !refinement;
+		cout << (refinement ? "refining" : "not refining") << " when the optimizer stalls, from its next start" << endl;
+	}
+	if(key == 'l' && library.isOpen()) {
+		if(optimizing) {
+			toggleOptimizer();
+		}
+		startFromLibrary();
+		updateGuiFromPose();
+		updateModel();
+	}
+	if(key == 'o') {
+		int levels = getLevelCount(optimizerReference.getWidth(), optimizerReference.getHeight());
+		compareOptimizers("rigged-human.dae", optimizerReference, handPose, 30, 0, levels, scorer.getCost());
+	}
 }